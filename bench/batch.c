@@ -0,0 +1,158 @@
+/*
+ *  batch.c
+ *  ccmd
+ *
+ *  Measures the per-line cost of ccmd_parse_batch on a large batch of short command lines, single-threaded and split
+ *  across a thread pool, against calling ccmd_parse once per line
+ *
+ *  Copyright (c) 2021 Jacob Milligan. All rights reserved.
+ */
+
+#include <ccmd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif // defined(_WIN32)
+
+#define BENCH_LINE_COUNT 200000
+#define BENCH_REPEATS 10
+#define BENCH_THREADS 4
+
+static double now_ns(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif // defined(_WIN32)
+}
+
+static char* line_get[] = { "kv", "get", "-k", "user:1234" };
+static char* line_set[] = { "kv", "set", "-k", "user:1234", "-v", "value", "--ttl", "30" };
+static char* line_del[] = { "kv", "--verbose", "del", "-k", "user:1234" };
+static char* line_stats[] = { "kv", "stats" };
+
+static const ccmd_command_line templates[] = {
+    { CCMD_ARRAY_SIZE(line_get), line_get },
+    { CCMD_ARRAY_SIZE(line_set), line_set },
+    { CCMD_ARRAY_SIZE(line_del), line_del },
+    { CCMD_ARRAY_SIZE(line_stats), line_stats },
+};
+
+static double time_batch(ccmd_batch* batch, const ccmd_compiled* compiled)
+{
+    const double begin = now_ns();
+    for (int r = 0; r < BENCH_REPEATS; ++r)
+    {
+        if (ccmd_parse_batch(batch, compiled) != CCMD_STATUS_SUCCESS)
+        {
+            fprintf(stderr, "batch failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return (now_ns() - begin) / ((double)BENCH_REPEATS * BENCH_LINE_COUNT);
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    static const ccmd_option key_option[] = {
+        { .short_name = 'k', .long_name = "key", .help = "key to operate on", .nargs = 1, .required = true },
+    };
+    static const ccmd_option set_options[] = {
+        { .short_name = 'k', .long_name = "key", .help = "key to operate on", .nargs = 1, .required = true },
+        { .short_name = 'v', .long_name = "value", .help = "value to store", .nargs = 1, .required = true },
+        { .short_name = 't', .long_name = "ttl", .help = "expiry in seconds", .nargs = 1 },
+    };
+    const ccmd_command cli = {
+        .name = "kv",
+        .options = CCMD_ARRAY_VIEW((ccmd_option[]) {
+            { .short_name = 'v', .long_name = "verbose", .help = "log every request" }
+        }),
+        .subcommands = CCMD_ARRAY_VIEW((ccmd_command[]) {
+            { .name = "get", .options = CCMD_ARRAY_VIEW(key_option) },
+            { .name = "set", .options = CCMD_ARRAY_VIEW(set_options) },
+            { .name = "del", .options = CCMD_ARRAY_VIEW(key_option) },
+            { .name = "stats" },
+        })
+    };
+
+    ccmd_compiled* compiled = ccmd_compile(&cli);
+
+    ccmd_command_line* lines = (ccmd_command_line*)malloc(sizeof(ccmd_command_line) * BENCH_LINE_COUNT);
+    ccmd_result* results = (ccmd_result*)calloc(BENCH_LINE_COUNT, sizeof(ccmd_result));
+    ccmd_status* statuses = (ccmd_status*)malloc(sizeof(ccmd_status) * BENCH_LINE_COUNT);
+    for (int i = 0; i < BENCH_LINE_COUNT; ++i)
+    {
+        lines[i] = templates[i % CCMD_ARRAY_SIZE(templates)];
+    }
+
+    const size_t arena_size = ccmd_batch_arena_size(lines, BENCH_LINE_COUNT, compiled);
+    ccmd_batch batch = {
+        .lines = { BENCH_LINE_COUNT, lines },
+        .results = { BENCH_LINE_COUNT, results },
+        .statuses = { BENCH_LINE_COUNT, statuses },
+        .arena = malloc(arena_size),
+        .arena_size = arena_size,
+    };
+
+    // baseline: one ccmd_parse per line with a context so nothing is printed
+    ccmd_context context = { 0 };
+    ccmd_command_result commands[4];
+    ccmd_parsed_args options[8];
+    ccmd_error errors[8];
+    ccmd_result result = {
+        .context = &context,
+        .commands = CCMD_ARRAY_VIEW(commands),
+        .options = CCMD_ARRAY_VIEW(options),
+        .errors = CCMD_ARRAY_VIEW(errors)
+    };
+
+    double begin = now_ns();
+    for (int r = 0; r < BENCH_REPEATS; ++r)
+    {
+        for (int i = 0; i < BENCH_LINE_COUNT; ++i)
+        {
+            ccmd_parse(&result, lines[i].argc, lines[i].argv, &cli);
+        }
+    }
+    const double single_ns = (now_ns() - begin) / ((double)BENCH_REPEATS * BENCH_LINE_COUNT);
+
+    const double batch_ns = time_batch(&batch, compiled);
+
+    batch.pool = ccmd_create_thread_pool(BENCH_THREADS - 1);
+    const double pool_ns = time_batch(&batch, compiled);
+    ccmd_free_thread_pool(batch.pool);
+
+    int failures = 0;
+    for (int i = 0; i < BENCH_LINE_COUNT; ++i)
+    {
+        failures += statuses[i] != CCMD_STATUS_SUCCESS ? 1 : 0;
+    }
+
+    printf("%d lines, arena %.1f MiB\n", BENCH_LINE_COUNT, (double)arena_size / (1024.0 * 1024.0));
+    printf("%-36s %8.1f ns/line\n", "ccmd_parse per line", single_ns);
+    printf("%-36s %8.1f ns/line\n", "ccmd_parse_batch", batch_ns);
+    printf("%-27s (%d threads) %8.1f ns/line\n", "ccmd_parse_batch", BENCH_THREADS, pool_ns);
+    printf("failed lines: %d\n", failures);
+
+    free(batch.arena);
+    free(statuses);
+    free(results);
+    free(lines);
+    ccmd_free_compiled(compiled);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
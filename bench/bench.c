@@ -0,0 +1,617 @@
+/*
+ *  bench.c
+ *  ccmd
+ *
+ *  Parser benchmark suite: runs ccmd_parse, ccmd_parse_compiled and getopt_long over synthetic specs - flat commands
+ *  with 10 to 10,000 options, subcommand trees up to 8 deep and commands with large positional counts - and reports
+ *  ns/argument, allocations per parse and, on Linux, hardware cycle and cache miss counters
+ *
+ *  ccmd.c is compiled directly into this file so that CCMD_MALLOC/CCMD_FREE can be routed through a counting allocator
+ *
+ *  Copyright (c) 2021 Jacob Milligan. All rights reserved.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+static int64_t bench_allocations = 0;
+static int64_t bench_allocated_bytes = 0;
+
+static void* bench_malloc(const size_t size)
+{
+    ++bench_allocations;
+    bench_allocated_bytes += (int64_t)size;
+    return malloc(size);
+}
+
+static void bench_free(void* ptr)
+{
+    free(ptr);
+}
+
+#define CCMD_MALLOC(SIZE) bench_malloc(SIZE)
+#define CCMD_FREE(PTR) bench_free(PTR)
+#include "ccmd.c"
+
+#include <stdio.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <time.h>
+    #include <getopt.h>
+    #define BENCH_HAS_GETOPT
+#endif // defined(_WIN32)
+
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #define BENCH_HAS_PERF
+#endif // defined(__linux__)
+
+#define BENCH_NAME_MAX 24
+#define BENCH_MAX_OPTIONS 10000
+#define BENCH_FLAT_ARGS 64
+#define BENCH_TREE_DEPTH_MAX 8
+#define BENCH_TREE_WIDTH 8
+#define BENCH_TREE_OPTIONS 32
+#define BENCH_TREE_ARGS_PER_LEVEL 8
+#define BENCH_POSITIONALS_MAX 1000
+#define BENCH_ARGV_MAX (BENCH_POSITIONALS_MAX + 1)
+
+typedef enum bench_parser
+{
+    BENCH_PARSER_CCMD,
+    BENCH_PARSER_COMPILED,
+    BENCH_PARSER_COMPILED_ARENA,
+    BENCH_PARSER_GETOPT,
+    BENCH_PARSER_COUNT
+} bench_parser;
+
+static const char* bench_parser_names[BENCH_PARSER_COUNT] = {
+    "ccmd_parse",       // BENCH_PARSER_CCMD
+    "compiled",         // BENCH_PARSER_COMPILED
+    "compiled+arena",   // BENCH_PARSER_COMPILED_ARENA
+    "getopt_long",      // BENCH_PARSER_GETOPT
+};
+
+typedef struct bench_workload
+{
+    char                name[32];
+    const ccmd_command* cli;
+    int32_t             depth; // commands on the parsed path, for the getopt_long baseline
+    int32_t             argc;
+    char*               argv[BENCH_ARGV_MAX];
+} bench_workload;
+
+typedef struct bench_stats
+{
+    double      ns_per_arg;
+    double      allocations_per_parse;
+    double      bytes_per_parse;
+    double      cycles_per_arg;
+    double      cache_misses_per_parse;
+    bool        has_counters;
+} bench_stats;
+
+static char option_names[BENCH_MAX_OPTIONS][BENCH_NAME_MAX];
+static char option_args[BENCH_MAX_OPTIONS][BENCH_NAME_MAX + 2];
+static char positional_names[BENCH_POSITIONALS_MAX][BENCH_NAME_MAX];
+static char command_names[BENCH_TREE_WIDTH][BENCH_NAME_MAX];
+static ccmd_option options[BENCH_MAX_OPTIONS];
+static ccmd_positional positionals[BENCH_POSITIONALS_MAX];
+static ccmd_command tree_levels[BENCH_TREE_DEPTH_MAX][BENCH_TREE_WIDTH];
+
+static double now_ns(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif // defined(_WIN32)
+}
+
+/*
+ **************************
+ *
+ * Hardware counters
+ *
+ **************************
+ */
+typedef struct bench_counters
+{
+    int         cycles_fd;
+    int         cache_misses_fd;
+} bench_counters;
+
+static bench_counters bench_counters_open(const bool enabled)
+{
+    bench_counters counters = { -1, -1 };
+#if defined(BENCH_HAS_PERF)
+    if (!enabled)
+    {
+        return counters;
+    }
+
+    const uint64_t configs[] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES };
+    int* fds[] = { &counters.cycles_fd, &counters.cache_misses_fd };
+    for (int i = 0; i < (int)CCMD_ARRAY_SIZE(configs); ++i)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[i];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        *fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#else
+    (void)enabled;
+#endif // defined(BENCH_HAS_PERF)
+    return counters;
+}
+
+static void bench_counters_close(bench_counters* counters)
+{
+#if defined(BENCH_HAS_PERF)
+    if (counters->cycles_fd >= 0)
+    {
+        close(counters->cycles_fd);
+    }
+    if (counters->cache_misses_fd >= 0)
+    {
+        close(counters->cache_misses_fd);
+    }
+#endif // defined(BENCH_HAS_PERF)
+    counters->cycles_fd = -1;
+    counters->cache_misses_fd = -1;
+}
+
+static bool bench_counters_valid(const bench_counters* counters)
+{
+    return counters->cycles_fd >= 0 && counters->cache_misses_fd >= 0;
+}
+
+static void bench_counters_start(const bench_counters* counters)
+{
+#if defined(BENCH_HAS_PERF)
+    if (bench_counters_valid(counters))
+    {
+        ioctl(counters->cycles_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters->cache_misses_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters->cycles_fd, PERF_EVENT_IOC_ENABLE, 0);
+        ioctl(counters->cache_misses_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)counters;
+#endif // defined(BENCH_HAS_PERF)
+}
+
+static void bench_counters_stop(const bench_counters* counters, uint64_t* cycles, uint64_t* cache_misses)
+{
+    *cycles = 0;
+    *cache_misses = 0;
+#if defined(BENCH_HAS_PERF)
+    if (bench_counters_valid(counters))
+    {
+        ioctl(counters->cycles_fd, PERF_EVENT_IOC_DISABLE, 0);
+        ioctl(counters->cache_misses_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counters->cycles_fd, cycles, sizeof(*cycles)) != sizeof(*cycles))
+        {
+            *cycles = 0;
+        }
+        if (read(counters->cache_misses_fd, cache_misses, sizeof(*cache_misses)) != sizeof(*cache_misses))
+        {
+            *cache_misses = 0;
+        }
+    }
+#else
+    (void)counters;
+#endif // defined(BENCH_HAS_PERF)
+}
+
+/*
+ **************************
+ *
+ * Synthetic specs
+ *
+ **************************
+ */
+static void bench_init_specs(void)
+{
+    // every fourth option takes a value so the parser has to consume arguments as well as match names
+    for (int i = 0; i < BENCH_MAX_OPTIONS; ++i)
+    {
+        snprintf(option_names[i], BENCH_NAME_MAX, "option-%05d", i);
+        snprintf(option_args[i], sizeof(option_args[i]), "--option-%05d", i);
+        options[i] = (ccmd_option) { .long_name = option_names[i], .help = "synthetic option", .nargs = i % 4 == 0 ? 1 : 0 };
+    }
+
+    for (int i = 0; i < BENCH_POSITIONALS_MAX; ++i)
+    {
+        snprintf(positional_names[i], BENCH_NAME_MAX, "input-%d", i);
+        positionals[i] = (ccmd_positional) { .name = positional_names[i], .help = "synthetic positional" };
+    }
+
+    // each level of the tree has BENCH_TREE_WIDTH siblings but only the first one continues on to the next level
+    for (int w = 0; w < BENCH_TREE_WIDTH; ++w)
+    {
+        snprintf(command_names[w], BENCH_NAME_MAX, "command-%d", w);
+    }
+
+    for (int depth = BENCH_TREE_DEPTH_MAX - 1; depth >= 0; --depth)
+    {
+        for (int w = 0; w < BENCH_TREE_WIDTH; ++w)
+        {
+            ccmd_command* command = &tree_levels[depth][w];
+            *command = (ccmd_command) {
+                .name = command_names[w],
+                .help = "synthetic command",
+                .options = { BENCH_TREE_OPTIONS, options },
+            };
+
+            if (w == 0 && depth + 1 < BENCH_TREE_DEPTH_MAX)
+            {
+                command->subcommands.count = BENCH_TREE_WIDTH;
+                command->subcommands.data = tree_levels[depth + 1];
+            }
+        }
+    }
+}
+
+static void bench_push_option(bench_workload* workload, const int32_t option_index)
+{
+    workload->argv[workload->argc++] = option_args[option_index];
+    if (options[option_index].nargs > 0)
+    {
+        workload->argv[workload->argc++] = "value";
+    }
+}
+
+static void bench_flat_workload(bench_workload* workload, ccmd_command* cli, const int32_t option_count)
+{
+    *cli = (ccmd_command) { .name = "bench", .help = "flat", .options = { option_count, options } };
+    snprintf(workload->name, sizeof(workload->name), "flat-%d", option_count);
+    workload->cli = cli;
+    workload->depth = 1;
+    workload->argc = 0;
+    workload->argv[workload->argc++] = "bench";
+
+    // options picked from anywhere in the spec
+    srand((unsigned)option_count);
+    for (int i = 0; i < BENCH_FLAT_ARGS; ++i)
+    {
+        bench_push_option(workload, rand() % option_count);
+    }
+}
+
+static void bench_tree_workload(bench_workload* workload, ccmd_command* cli, const int32_t depth)
+{
+    *cli = (ccmd_command) {
+        .name = "bench",
+        .help = "tree",
+        .options = { BENCH_TREE_OPTIONS, options },
+        .subcommands = { BENCH_TREE_WIDTH, tree_levels[0] },
+    };
+    snprintf(workload->name, sizeof(workload->name), "tree-depth-%d", depth);
+    workload->cli = cli;
+    workload->depth = depth;
+    workload->argc = 0;
+    workload->argv[workload->argc++] = "bench";
+
+    srand((unsigned)depth);
+    for (int level = 0; level < depth; ++level)
+    {
+        for (int i = 0; i < BENCH_TREE_ARGS_PER_LEVEL; ++i)
+        {
+            bench_push_option(workload, rand() % BENCH_TREE_OPTIONS);
+        }
+
+        if (level + 1 < depth)
+        {
+            workload->argv[workload->argc++] = command_names[0];
+        }
+    }
+}
+
+static void bench_positional_workload(bench_workload* workload, ccmd_command* cli, const int32_t positional_count)
+{
+    *cli = (ccmd_command) { .name = "bench", .help = "positionals", .positionals = { positional_count, positionals } };
+    snprintf(workload->name, sizeof(workload->name), "positionals-%d", positional_count);
+    workload->cli = cli;
+    workload->depth = 1;
+    workload->argc = 0;
+    workload->argv[workload->argc++] = "bench";
+    for (int i = 0; i < positional_count; ++i)
+    {
+        workload->argv[workload->argc++] = positional_names[i];
+    }
+}
+
+/*
+ **************************
+ *
+ * getopt_long baseline
+ *
+ **************************
+ */
+#if defined(BENCH_HAS_GETOPT)
+static struct option* bench_getopt_options(const ccmd_command* command)
+{
+    struct option* long_options = (struct option*)calloc((size_t)command->options.count + 1, sizeof(struct option));
+    for (int i = 0; i < command->options.count; ++i)
+    {
+        long_options[i].name = command->options.data[i].long_name;
+        long_options[i].has_arg = command->options.data[i].nargs > 0 ? required_argument : no_argument;
+        long_options[i].val = 0x100 + i;
+    }
+    return long_options;
+}
+
+// Parses the same command line a hand-written getopt_long program would: options up to the first non-option, then
+// the subcommand name becomes argv[0] for the next level
+static int bench_getopt_parse(const bench_workload* workload, const struct option* long_options)
+{
+    int handled = 0;
+    int begin = 0;
+    for (int level = 0; level < workload->depth; ++level)
+    {
+#if defined(__GLIBC__)
+        optind = 0; // full reinitialization
+#else
+        optind = 1;
+        optreset = 1;
+#endif // defined(__GLIBC__)
+
+        char** level_argv = (char**)workload->argv + begin;
+        const int level_argc = workload->argc - begin;
+        int c = 0;
+        // a single command permutes so every option is found, nested ones have to stop at the subcommand name
+        const char* short_options = workload->depth > 1 ? "+" : "";
+        while ((c = getopt_long(level_argc, level_argv, short_options, long_options, NULL)) != -1)
+        {
+            if (c == '?')
+            {
+                return -1;
+            }
+            ++handled;
+        }
+
+        begin += optind;
+    }
+    return handled;
+}
+#endif // defined(BENCH_HAS_GETOPT)
+
+/*
+ **************************
+ *
+ * Runner
+ *
+ **************************
+ */
+static bool bench_run(const bench_workload* workload, const bench_parser parser, const double min_time_ns, const bench_counters* counters, bench_stats* stats)
+{
+    const ccmd_capacity capacity = ccmd_required_capacity(workload->cli, workload->argc, workload->argv);
+    ccmd_compiled* compiled = parser == BENCH_PARSER_COMPILED || parser == BENCH_PARSER_COMPILED_ARENA
+        ? ccmd_compile(workload->cli)
+        : NULL;
+
+    // the arena replaces `commands` and `options` on every parse so keep hold of the buffers to free them
+    ccmd_command_result* commands = (ccmd_command_result*)malloc(sizeof(ccmd_command_result) * capacity.commands);
+    ccmd_parsed_args* parsed = (ccmd_parsed_args*)malloc(sizeof(ccmd_parsed_args) * capacity.options);
+    ccmd_error* errors = (ccmd_error*)malloc(sizeof(ccmd_error) * capacity.errors);
+
+    ccmd_context context = { 0 };
+    ccmd_result result = { .context = &context };
+    result.commands.count = capacity.commands;
+    result.commands.data = commands;
+    result.options.count = capacity.options;
+    result.options.data = parsed;
+    result.errors.count = capacity.errors;
+    result.errors.data = errors;
+    if (parser == BENCH_PARSER_COMPILED_ARENA)
+    {
+        result.arena = ccmd_create_arena(0);
+    }
+
+#if defined(BENCH_HAS_GETOPT)
+    struct option* long_options = parser == BENCH_PARSER_GETOPT ? bench_getopt_options(workload->cli) : NULL;
+    opterr = 0;
+#endif // defined(BENCH_HAS_GETOPT)
+
+    bool success = true;
+    int64_t iterations = 0;
+    int64_t allocations = 0;
+    int64_t allocated_bytes = 0;
+    uint64_t cycles = 0;
+    uint64_t cache_misses = 0;
+    double elapsed_ns = 0.0;
+
+    // grow the batch of iterations until a single timed run takes long enough to trust
+    for (int64_t batch = 1; elapsed_ns < min_time_ns && success; batch *= 2)
+    {
+        const int64_t allocations_begin = bench_allocations;
+        const int64_t bytes_begin = bench_allocated_bytes;
+        bench_counters_start(counters);
+        const double begin = now_ns();
+
+        for (int64_t i = 0; i < batch && success; ++i)
+        {
+            switch (parser)
+            {
+                case BENCH_PARSER_CCMD:
+                    success = ccmd_parse(&result, workload->argc, workload->argv, workload->cli) == CCMD_STATUS_SUCCESS;
+                    break;
+                case BENCH_PARSER_COMPILED:
+                    success = ccmd_parse_compiled(&result, workload->argc, workload->argv, compiled) == CCMD_STATUS_SUCCESS;
+                    break;
+                case BENCH_PARSER_COMPILED_ARENA:
+                    success = ccmd_parse_compiled(&result, workload->argc, workload->argv, compiled) == CCMD_STATUS_SUCCESS;
+                    ccmd_reset_arena(result.arena);
+                    break;
+#if defined(BENCH_HAS_GETOPT)
+                case BENCH_PARSER_GETOPT:
+                    success = bench_getopt_parse(workload, long_options) >= 0;
+                    break;
+#endif // defined(BENCH_HAS_GETOPT)
+                default:
+                    success = false;
+                    break;
+            }
+        }
+
+        elapsed_ns = now_ns() - begin;
+        bench_counters_stop(counters, &cycles, &cache_misses);
+        allocations = bench_allocations - allocations_begin;
+        allocated_bytes = bench_allocated_bytes - bytes_begin;
+        iterations = batch;
+    }
+
+    const double args = (double)(workload->argc - 1);
+    stats->ns_per_arg = elapsed_ns / ((double)iterations * args);
+    stats->allocations_per_parse = (double)allocations / (double)iterations;
+    stats->bytes_per_parse = (double)allocated_bytes / (double)iterations;
+    stats->has_counters = bench_counters_valid(counters);
+    stats->cycles_per_arg = (double)cycles / ((double)iterations * args);
+    stats->cache_misses_per_parse = (double)cache_misses / (double)iterations;
+
+#if defined(BENCH_HAS_GETOPT)
+    free(long_options);
+#endif // defined(BENCH_HAS_GETOPT)
+    ccmd_free_arena(result.arena);
+    free(errors);
+    free(parsed);
+    free(commands);
+    ccmd_free_compiled(compiled);
+    return success;
+}
+
+static void bench_report(const bench_workload* workload, const bench_parser parser, const bench_stats* stats)
+{
+    printf("%-18s %6d  %-16s %10.2f", workload->name, workload->argc - 1, bench_parser_names[parser], stats->ns_per_arg);
+
+    // the counting allocator only sees allocations made by ccmd
+    if (parser == BENCH_PARSER_GETOPT)
+    {
+        printf(" %12s %12s", "-", "-");
+    }
+    else
+    {
+        printf(" %12.2f %12.1f", stats->allocations_per_parse, stats->bytes_per_parse);
+    }
+
+    if (stats->has_counters)
+    {
+        printf(" %12.1f %14.1f", stats->cycles_per_arg, stats->cache_misses_per_parse);
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    static const ccmd_option bench_options[] = {
+        { .long_name = "perf", .short_name = 'p', .help = "read cycle and cache miss counters with perf_event_open (Linux only)",
+            .action = CCMD_ACTION_STORE_TRUE, .offset = 0 },
+        { .long_name = "min-time", .short_name = 't', .help = "minimum time to run each benchmark for i.e. 200ms", .nargs = 1,
+            .value_type = CCMD_VALUE_DURATION },
+    };
+    const ccmd_command cli = {
+        .name = "ccmd_bench",
+        .help = "parser benchmark suite",
+        .options = CCMD_ARRAY_VIEW(bench_options),
+    };
+
+    bool use_counters = false;
+    ccmd_command_result commands[1];
+    ccmd_parsed_args parsed[8];
+    ccmd_value values[8];
+    ccmd_result result = {
+        .commands = CCMD_ARRAY_VIEW(commands),
+        .options = CCMD_ARRAY_VIEW(parsed),
+        .values = CCMD_ARRAY_VIEW(values),
+        .destination = &use_counters,
+    };
+
+    const ccmd_status status = ccmd_parse(&result, argc, argv, &cli);
+    if (status != CCMD_STATUS_SUCCESS)
+    {
+        return status == CCMD_STATUS_ERROR ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    const ccmd_parsed_args* min_time = ccmd_get_option(&commands[0], "min-time");
+    const double min_time_ns = min_time != NULL ? (double)min_time->values[0].duration_ns : 100e6;
+
+    bench_counters counters = bench_counters_open(use_counters);
+    if (use_counters && !bench_counters_valid(&counters))
+    {
+        fprintf(stderr, "ccmd_bench: hardware counters are unavailable on this system\n");
+    }
+
+    bench_init_specs();
+
+    static bench_workload workloads[16];
+    static ccmd_command clis[16];
+    int workload_count = 0;
+
+    static const int32_t option_counts[] = { 10, 100, 1000, 10000 };
+    for (int i = 0; i < (int)CCMD_ARRAY_SIZE(option_counts); ++i, ++workload_count)
+    {
+        bench_flat_workload(&workloads[workload_count], &clis[workload_count], option_counts[i]);
+    }
+
+    static const int32_t depths[] = { 1, 4, 8 };
+    for (int i = 0; i < (int)CCMD_ARRAY_SIZE(depths); ++i, ++workload_count)
+    {
+        bench_tree_workload(&workloads[workload_count], &clis[workload_count], depths[i]);
+    }
+
+    static const int32_t positional_counts[] = { 100, BENCH_POSITIONALS_MAX };
+    for (int i = 0; i < (int)CCMD_ARRAY_SIZE(positional_counts); ++i, ++workload_count)
+    {
+        bench_positional_workload(&workloads[workload_count], &clis[workload_count], positional_counts[i]);
+    }
+
+    printf("%-18s %6s  %-16s %10s %12s %12s", "workload", "args", "parser", "ns/arg", "allocs/parse", "bytes/parse");
+    if (bench_counters_valid(&counters))
+    {
+        printf(" %12s %14s", "cycles/arg", "misses/parse");
+    }
+    printf("\n");
+
+    int failures = 0;
+    for (int w = 0; w < workload_count; ++w)
+    {
+        for (int p = 0; p < BENCH_PARSER_COUNT; ++p)
+        {
+#if !defined(BENCH_HAS_GETOPT)
+            if (p == BENCH_PARSER_GETOPT)
+            {
+                continue;
+            }
+#endif // !defined(BENCH_HAS_GETOPT)
+
+            bench_stats stats;
+            if (!bench_run(&workloads[w], (bench_parser)p, min_time_ns, &counters, &stats))
+            {
+                fprintf(stderr, "ccmd_bench: %s failed to parse %s\n", bench_parser_names[p], workloads[w].name);
+                ++failures;
+                continue;
+            }
+            bench_report(&workloads[w], (bench_parser)p, &stats);
+        }
+    }
+
+    bench_counters_close(&counters);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
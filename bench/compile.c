@@ -0,0 +1,120 @@
+/*
+ *  compile.c
+ *  ccmd
+ *
+ *  Measures how parse time scales with the number of options declared on a command, comparing ccmd_parse
+ *  against ccmd_parse_compiled
+ *
+ *  Copyright (c) 2021 Jacob Milligan. All rights reserved.
+ */
+
+#include <ccmd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif // defined(_WIN32)
+
+#define BENCH_ARGC 65
+#define BENCH_NAME_MAX 16
+#define BENCH_MAX_OPTIONS 10000
+#define BENCH_TOTAL_LOOKUPS 20000000
+#define BENCH_MAX(X, Y) ((X) >= (Y) ? (X) : (Y))
+
+static char option_names[BENCH_MAX_OPTIONS][BENCH_NAME_MAX];
+static char arg_strings[BENCH_ARGC][BENCH_NAME_MAX + 2];
+static ccmd_option options[BENCH_MAX_OPTIONS];
+
+static double now_ns(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif // defined(_WIN32)
+}
+
+static double time_parse(const int iterations, char* const* argv, const ccmd_command* cli, const ccmd_compiled* compiled)
+{
+    ccmd_command_result commands[2];
+    ccmd_parsed_args parsed[BENCH_ARGC + 1];
+    ccmd_error errors[CCMD_ERROR_MAX];
+    ccmd_result result = {
+        .commands = CCMD_ARRAY_VIEW(commands),
+        .options = CCMD_ARRAY_VIEW(parsed),
+        .errors = CCMD_ARRAY_VIEW(errors)
+    };
+
+    const double begin = now_ns();
+    for (int i = 0; i < iterations; ++i)
+    {
+        const ccmd_status status = compiled != NULL
+            ? ccmd_parse_compiled(&result, BENCH_ARGC, argv, compiled)
+            : ccmd_parse(&result, BENCH_ARGC, argv, cli);
+
+        if (status != CCMD_STATUS_SUCCESS)
+        {
+            fprintf(stderr, "parse failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return (now_ns() - begin) / (double)iterations;
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    static const int option_counts[] = { 10, 100, 1000, 10000 };
+    char* bench_argv[BENCH_ARGC];
+
+    for (int i = 0; i < BENCH_MAX_OPTIONS; ++i)
+    {
+        snprintf(option_names[i], BENCH_NAME_MAX, "option-%05d", i);
+        options[i] = (ccmd_option) { .long_name = option_names[i], .help = "synthetic option", .nargs = 0 };
+    }
+
+    printf("%-10s %18s %18s %10s\n", "options", "ccmd_parse (ns)", "compiled (ns)", "speedup");
+
+    for (int c = 0; c < (int)CCMD_ARRAY_SIZE(option_counts); ++c)
+    {
+        const int option_count = option_counts[c];
+        const ccmd_command cli = {
+            .name = "bench",
+            .options = { option_count, options }
+        };
+
+        // every argument is a valid option picked from anywhere in the spec
+        srand(option_count);
+        bench_argv[0] = "bench";
+        for (int i = 1; i < BENCH_ARGC; ++i)
+        {
+            snprintf(arg_strings[i], sizeof(arg_strings[i]), "--%s", option_names[rand() % option_count]);
+            bench_argv[i] = arg_strings[i];
+        }
+
+        ccmd_compiled* compiled = ccmd_compile(&cli);
+
+        // keep the total number of linear comparisons roughly constant between runs
+        const int iterations = BENCH_MAX(BENCH_TOTAL_LOOKUPS / (option_count * (BENCH_ARGC - 1)), 16);
+        const double uncompiled_ns = time_parse(iterations, bench_argv, &cli, NULL);
+        const double compiled_ns = time_parse(iterations * 16, bench_argv, &cli, compiled);
+
+        printf("%-10d %18.1f %18.1f %9.1fx\n", option_count, uncompiled_ns, compiled_ns, uncompiled_ns / compiled_ns);
+
+        ccmd_free_compiled(compiled);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,3 +1,9 @@
+// unix builds use POSIX and BSD extensions (i.e. MAP_ANONYMOUS) which a strict -std=c99 hides unless they're requested
+// before the first system header is included
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+    #define _DEFAULT_SOURCE
+#endif // !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+
 /*
  *  cplatform.h
  *  Collection of macros and utilities for writing cross-platform C/C++ code
@@ -348,8 +354,101 @@ namespace ccmd {
 #include <stdarg.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <math.h>
+#include <errno.h>
+
+#if CPLATFORM_OS_WINDOWS == 1
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif // WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/uio.h>
+    #include <sys/ioctl.h>
+
+    #if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+        #define MAP_ANONYMOUS MAP_ANON
+    #endif // !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#endif // CPLATFORM_OS_WINDOWS == 1
+
+#if !defined(CCMD_DISABLE_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+    #define CCMD_SIMD_X86 1
+    #include <immintrin.h>
+    #if CPLATFORM_COMPILER_MSVC == 1
+        #include <intrin.h>
+    #endif // CPLATFORM_COMPILER_MSVC == 1
+#else
+    #define CCMD_SIMD_X86 0
+#endif // !defined(CCMD_DISABLE_SIMD) && x86_64
+
+// The vectorized argument scan does aligned loads that may read past the terminating '\0' of an argument (but never
+// into the next page) which address sanitizer would otherwise report
+#if defined(__SANITIZE_ADDRESS__)
+    #define CCMD_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#elif defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+        #define CCMD_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+    #endif // __has_feature(address_sanitizer)
+#endif // defined(__SANITIZE_ADDRESS__)
+#ifndef CCMD_NO_SANITIZE_ADDRESS
+    #define CCMD_NO_SANITIZE_ADDRESS
+#endif // CCMD_NO_SANITIZE_ADDRESS
+
+// Instrumentation counters and phase timers - these expand to nothing unless CCMD_ENABLE_INSTRUMENTATION is defined
+#if defined(CCMD_ENABLE_INSTRUMENTATION)
+    #if CPLATFORM_OS_WINDOWS == 0
+        #include <time.h>
+    #endif // CPLATFORM_OS_WINDOWS == 0
+    #define CCMD_INSTRUMENT_ADD(RESULT, COUNTER, AMOUNT) do { if ((RESULT)->instrumentation != NULL) { (RESULT)->instrumentation->COUNTER += (AMOUNT); } } while (0)
+    #define CCMD_INSTRUMENT_BEGIN(RESULT) ((RESULT)->instrumentation != NULL ? ccmd_now_ns() : 0)
+    #define CCMD_INSTRUMENT_END(RESULT, PHASE, BEGIN) CCMD_INSTRUMENT_ADD(RESULT, phase_ns[PHASE], ccmd_now_ns() - (BEGIN))
+    // ends PHASE and takes the same time back out of the phase it interrupted
+    #define CCMD_INSTRUMENT_END_NESTED(RESULT, PHASE, OUTER_PHASE, BEGIN)                   \
+        do {                                                                                \
+            if ((RESULT)->instrumentation != NULL) {                                        \
+                const int64_t ccmd_elapsed_ns = ccmd_now_ns() - (BEGIN);                    \
+                (RESULT)->instrumentation->phase_ns[PHASE] += ccmd_elapsed_ns;              \
+                (RESULT)->instrumentation->phase_ns[OUTER_PHASE] -= ccmd_elapsed_ns;        \
+            }                                                                               \
+        } while (0)
+#else
+    #define CCMD_INSTRUMENT_ADD(RESULT, COUNTER, AMOUNT) ((void)(RESULT))
+    #define CCMD_INSTRUMENT_BEGIN(RESULT) 0
+    #define CCMD_INSTRUMENT_END(RESULT, PHASE, BEGIN) ((void)(BEGIN))
+    #define CCMD_INSTRUMENT_END_NESTED(RESULT, PHASE, OUTER_PHASE, BEGIN) ((void)(BEGIN))
+#endif // defined(CCMD_ENABLE_INSTRUMENTATION)
+
+// Arguments are classified on the stack up to this count and in a heap allocation beyond it
+#ifndef CCMD_ARG_INFO_STACK_MAX
+    #define CCMD_ARG_INFO_STACK_MAX 128
+#endif // CCMD_ARG_INFO_STACK_MAX
+
+#ifndef CCMD_ARENA_BLOCK_SIZE
+    #define CCMD_ARENA_BLOCK_SIZE 16384
+#endif // CCMD_ARENA_BLOCK_SIZE
+
+// Most @file response files that can be open at once while expanding nested ones
+#ifndef CCMD_RESPONSE_FILE_DEPTH_MAX
+    #define CCMD_RESPONSE_FILE_DEPTH_MAX 16
+#endif // CCMD_RESPONSE_FILE_DEPTH_MAX
+
+#ifndef CCMD_MALLOC
+    #define CCMD_MALLOC(SIZE) malloc(SIZE)
+#endif // CCMD_MALLOC
+#ifndef CCMD_FREE
+    #define CCMD_FREE(PTR) free(PTR)
+#endif // CCMD_FREE
 
 #define CCMD_HELP_MIN_COLS 16
+#define CCMD_NAME_NOT_FOUND -1
+#define CCMD_NAME_AMBIGUOUS -2 // an abbreviation that's a prefix of more than one name
+#define CCMD_SUGGEST_DISTANCE_MAX 2 // most edits an unrecognized name can be from the name suggested for it
+#define CCMD_HELP_MIN_WRAP 24 // narrowest column help strings are wrapped to
 #define CCMD_ERROR_KEY_CATEGORY(KEY) ((KEY) & ((1 << 16) - 1))
 #define CCMD_ERROR_KEY_ARG_TYPE(KEY) ((KEY) >> 16)
 #define CCMD_ERROR_KEY(CATEGORY, ARG_TYPE) ((CATEGORY) | ((ARG_TYPE) << 16))
@@ -361,15 +460,29 @@ typedef enum ccmd_error_category
     CCMD_ERROR_CATEGORY_MISSING_REQUIRED_ARGUMENT,
     CCMD_ERROR_CATEGORY_UNRECOGNIZED_ARGUMENT,
     CCMD_ERROR_CATEGORY_INTERNAL,
+    CCMD_ERROR_CATEGORY_RESPONSE_FILE,
+    CCMD_ERROR_CATEGORY_INVALID_QUOTING,
+    CCMD_ERROR_CATEGORY_INVALID_VALUE,
+    CCMD_ERROR_CATEGORY_INVALID_CHOICE,
+    CCMD_ERROR_CATEGORY_AMBIGUOUS_ARGUMENT,
     CCMD_ERROR_CATEGORY_COUNT
 } ccmd_error_category;
 
+typedef enum ccmd_response_file_error
+{
+    CCMD_RESPONSE_FILE_ERROR_CYCLE,
+    CCMD_RESPONSE_FILE_ERROR_DEPTH,
+    CCMD_RESPONSE_FILE_ERROR_ALLOCATION,
+    CCMD_RESPONSE_FILE_ERROR_COUNT
+} ccmd_response_file_error;
+
 typedef enum ccmd_argument_type
 {
     CCMD_ARGUMENT_OPTION,
     CCMD_ARGUMENT_OPTION_N_OR_MORE,
     CCMD_ARGUMENT_POSITIONAL,
     CCMD_ARGUMENT_SUBCOMMAND,
+    CCMD_ARGUMENT_APPLET,
     CCMD_ARGUMENT_INVALID
 } ccmd_argument_type;
 
@@ -388,889 +501,5706 @@ typedef struct ccmd_token
     ccmd_token_type  type;
     const char*     value;
     int32_t         length;
+
+    // slice of the argument after the option name - the value after '=' for long options or the rest of the cluster
+    // for short ones. NULL if there's nothing after the name
+    char*           attached;
+    int32_t         attached_length;
 } ccmd_token;
 
+// Result of the classification pre-pass over argv - one per argument
+typedef struct ccmd_arg_info
+{
+    int32_t     length;
+    int32_t     equals;     // index of the first '=' in the argument or -1 if there isn't one
+    uint8_t     dashes;     // number of leading dashes, clamped to 3
+} ccmd_arg_info;
+
+typedef void(*ccmd_scan_args_function)(const int32_t argc, char* const* argv, ccmd_arg_info* infos);
+
 typedef struct ccmd_formatter
 {
     int32_t                     buffer_capacity;
     int32_t                     length;
     char*                       buffer;
+    bool                        overflow; // set if any output was truncated
+
+    // optional - stream to a writer instead of truncating. `buffer` then only stages output and is flushed along with
+    // any long strings referenced in `chunks` whenever either fills up
+    const ccmd_writer*          sink;
+    ccmd_write_chunk*           chunks;
+    int32_t                     chunk_capacity;
+    int32_t                     chunk_count;
+    int32_t                     chunk_begin; // start of the buffered output that isn't in `chunks` yet
+    int32_t                     flushed;     // bytes already written to `sink`
 } ccmd_formatter;
 
+typedef struct ccmd_hash_slot
+{
+    const char*     name;
+    uint32_t        hash;
+    int32_t         index;
+} ccmd_hash_slot;
+
+typedef struct ccmd_hash_table
+{
+    uint32_t            mask;
+    ccmd_hash_slot*     slots;
+} ccmd_hash_table;
+
+typedef struct ccmd_option_slot
+{
+    const char*     name;
+    int32_t         length;
+    int32_t         index;
+} ccmd_option_slot;
+
+// Collision-free (hash and displace) table of long option names plus a direct lookup table for short names
+struct ccmd_option_table
+{
+    int16_t             short_options[256];
+    uint32_t            bucket_mask;
+    uint32_t            slot_mask;
+    ccmd_option_slot*   slots;
+    uint32_t*           seeds;
+};
+
+typedef struct ccmd_usage_cache
+{
+    int32_t     length;
+    int32_t     width; // columns the text was wrapped to or 0 if it wasn't
+    char        text[];
+} ccmd_usage_cache;
+
+// Name and declaration index of an option or subcommand, sorted by name so completions are a binary search away or
+// by length so suggestions only look at names that could be close enough
+typedef struct ccmd_sorted_name
+{
+    const char* name;
+    int32_t     index;
+    int32_t     length;
+} ccmd_sorted_name;
+
+// Compressed trie over a command's long option or subcommand names for resolving abbreviations. Each node's label is
+// a run of characters shared by every name below it and children are stored contiguously
+typedef struct ccmd_trie_node
+{
+    const char* label; // points into one of the names
+    int32_t     label_length;
+    int32_t     first_child;
+    int32_t     child_count;
+    int32_t     index;  // name that ends at this node or -1
+    int32_t     unique; // the only distinct name in this subtree or -1 if there are several
+} ccmd_trie_node;
+
+typedef struct ccmd_trie
+{
+    const ccmd_trie_node*   nodes; // nodes[0] is the root
+    int32_t                 count;
+} ccmd_trie;
+
+typedef struct ccmd_compiled_node
+{
+    const ccmd_command*         command;
+    int32_t                     parent;
+    int32_t                     depth;
+    int32_t                     first_subcommand; // subcommand nodes are stored contiguously in declaration order
+    const ccmd_option_table*    options;
+    const ccmd_hash_table*      choices; // one table per option or NULL if none of the options have choices
+    ccmd_hash_table             subcommands;
+    const ccmd_sorted_name*     sorted_options;     // options with long names only
+    int32_t                     sorted_option_count;
+    const ccmd_sorted_name*     sorted_subcommands; // one per subcommand
+    const ccmd_sorted_name*     options_by_length;  // same names as above sorted by length
+    const ccmd_sorted_name*     subcommands_by_length;
+    ccmd_trie                   option_trie;
+    ccmd_trie                   subcommand_trie;
+    int32_t                     help_column; // where help strings start in the command's usage
+    void* volatile              usage; // ccmd_usage_cache* rendered on first use - access atomically
+    void* volatile              help;  // same as `usage` but wrapped to the first terminal width it's rendered at
+} ccmd_compiled_node;
+
+struct ccmd_compiled
+{
+    int32_t                 node_count;
+    int32_t                 max_depth;
+    int32_t                 option_count;
+    int32_t                 max_command_errors; // most errors a single command can produce
+    int32_t                 max_path_options;   // most options declared by the commands along any one path
+    bool                    has_values;         // true if any option has a value type or choices
+    int32_t                 choice_table_count;
+    int32_t                 sorted_name_count;
+    int32_t                 slot_count;
+    size_t                  option_tables_size;
+    ccmd_compiled_node*     nodes;
+    ccmd_hash_slot*         slots;
+};
+
+// Every applet name and alias hashed to its index in `applets`
+struct ccmd_multicall
+{
+    int32_t                 applet_count;
+    const ccmd_applet*      applets;
+    ccmd_hash_table         names;
+};
+
 typedef struct ccmd_parser
 {
-    const ccmd_command**     command_infos;
-    ccmd_command_result*     command_result;
-    ccmd_result*             program_result;
+    const ccmd_compiled*            compiled;      // NULL if parsing an uncompiled command spec
+    const ccmd_command**            command_infos;
+    const ccmd_compiled_node**      command_nodes;
+    ccmd_command_result*            command_result;
+    ccmd_result*                    program_result;
+    int32_t                         option_id_count; // entries of `program_result->option_ids` used so far
+    int32_t                         value_count;     // entries of `program_result->values` used so far
 } ccmd_parser;
 
+typedef struct ccmd_arena_block
+{
+    struct ccmd_arena_block*    next;
+    size_t                      capacity;
+    size_t                      used;
+} ccmd_arena_block;
+
+// response files mapped into memory - they live as long as the arena memory that points into them
+typedef struct ccmd_mapped_file
+{
+    struct ccmd_mapped_file*    next;
+    void*                       address;
+    size_t                      size;
+} ccmd_mapped_file;
+
+struct ccmd_arena
+{
+    size_t                      block_size;
+    ccmd_arena_block*           first;
+    ccmd_arena_block*           current;
+    ccmd_mapped_file*           mapped_files;
+};
+
 
 /*
  **************************
  *
- * Utils API
+ * Arena API
  *
  **************************
  */
-int ccmd_option_display_length(const ccmd_option* opt)
+#define CCMD_ARENA_ALIGNMENT 16
+
+static char* ccmd_arena_block_data(ccmd_arena_block* block)
 {
-    int size = 2; // 2 extra for '--'
-    if (opt->long_name != NULL)
-    {
-        size += (int)strlen(opt->long_name);
-    }
-    if (opt->short_name != '\0')
-    {
-        size += 4; // 3 extra for the leading '-' and trailing ', '
-    }
-    return size;
+    return (char*)block + CPLATFORM_ROUND_UP(sizeof(ccmd_arena_block), CCMD_ARENA_ALIGNMENT);
 }
 
-ccmd_parsed_args* add_option(ccmd_parser* parser)
+static void* ccmd_arena_alloc(ccmd_arena* arena, const size_t size)
 {
-    const int index = parser->program_result->option_count;
-    assert(index < parser->program_result->options.count - 1);
+    const size_t aligned_size = CPLATFORM_ROUND_UP(size, CCMD_ARENA_ALIGNMENT);
 
-    ++parser->program_result->option_count;
-    ++parser->command_result->options.count;
-
-    if (parser->command_result->options.data == NULL)
+    // blocks are kept after a reset so walk forward through them before allocating a new one
+    ccmd_arena_block* block = arena->current;
+    while (block != NULL && block->capacity - block->used < aligned_size)
     {
-        parser->command_result->options.data = &parser->program_result->options.data[index];
+        block = block->next;
+        if (block != NULL)
+        {
+            block->used = 0;
+        }
     }
 
-    return &parser->program_result->options.data[index];
-}
-
-void ccmd_add_error(ccmd_result* result, const ccmd_error_category category, const enum ccmd_argument_type arg_type, const char char8, const char* str, const int32_t int32)
-{
-    if (result->error_count >= result->errors.count)
+    if (block == NULL)
     {
-        fprintf(stderr, "too many errors were generated\n");
-        return;
-    }
+        const size_t capacity = CPLATFORM_MAX(arena->block_size, aligned_size);
+        block = (ccmd_arena_block*)CCMD_MALLOC(CPLATFORM_ROUND_UP(sizeof(ccmd_arena_block), CCMD_ARENA_ALIGNMENT) + capacity);
+        if (block == NULL)
+        {
+            return NULL;
+        }
 
-    ccmd_error* stored = &result->errors.data[result->error_count++];
-    stored->key = CCMD_ERROR_KEY(category, arg_type);
-    stored->char8 = char8;
-    stored->str = str;
-    stored->int32 = int32;
-}
+        block->capacity = capacity;
+        block->used = 0;
 
-void ccmd_remove_error(ccmd_result* result, const ccmd_error_category category, const enum ccmd_argument_type arg_type, const char char8, const char* str)
-{
-    const uint32_t key = CCMD_ERROR_KEY(category, arg_type);
-    for (int i = 0; i < result->error_count; ++i)
-    {
-        const ccmd_error* error = &result->errors.data[i];
-        if (error->key != key
-            || error->char8 != char8
-            || (str == NULL) != (error->str == NULL)
-            || strcmp(error->str, str) != 0)
+        // insert after the current block so any blocks that were too small are still reused after the next reset
+        if (arena->current != NULL)
         {
-            continue;
+            block->next = arena->current->next;
+            arena->current->next = block;
         }
-
-        // found the error - swap the last with this error and decrement
-        if (i < result->error_count - 1)
+        else
         {
-            memcpy(&result->errors.data[i], &result->errors.data[result->error_count - 1], sizeof(ccmd_error));
+            block->next = NULL;
+            arena->first = block;
         }
+    }
 
-        --result->error_count;
-        break;
+    arena->current = block;
+    void* ptr = ccmd_arena_block_data(block) + block->used;
+    block->used += aligned_size;
+    return ptr;
+}
+
+static void ccmd_arena_unmap_files(ccmd_arena* arena)
+{
+    // the list nodes are allocated from the arena itself so they're reclaimed by the reset
+    for (ccmd_mapped_file* file = arena->mapped_files; file != NULL; file = file->next)
+    {
+#if CPLATFORM_OS_WINDOWS == 0
+        munmap(file->address, file->size);
+#endif // CPLATFORM_OS_WINDOWS == 0
     }
+    arena->mapped_files = NULL;
 }
 
 /*
  **************************
  *
- * String formatter API
+ * Response files
  *
  **************************
  */
-int ccmd_fmt_vsnprintf(struct ccmd_formatter* formatter, const char* format, va_list args)
+typedef struct ccmd_file_id
 {
-    char* dst = formatter->buffer + formatter->length;
-    const int dst_size = formatter->buffer_capacity - formatter->length;
+    uint64_t    device;
+    uint64_t    inode;
+} ccmd_file_id;
 
-    int count = vsnprintf(dst, dst_size, format, args);
-    if (count > 0)
-    {
-        formatter->length += count;
-    }
+typedef enum ccmd_load_status
+{
+    CCMD_LOAD_SUCCESS,
+    CCMD_LOAD_UNREADABLE,
+    CCMD_LOAD_OUT_OF_MEMORY
+} ccmd_load_status;
 
-    return count;
+typedef struct ccmd_arg_expander
+{
+    ccmd_arena*                 arena;
+    int32_t                     argc;
+    int32_t                     capacity;
+    char**                      argv;
+    int32_t                     depth;
+    ccmd_file_id                open_files[CCMD_RESPONSE_FILE_DEPTH_MAX];
+    int32_t                     error;      // a ccmd_response_file_error or -1
+    const char*                 error_path;
+} ccmd_arg_expander;
+
+static bool ccmd_is_response_file_space(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f' || c == '\0';
 }
 
-int ccmd_fmt(struct ccmd_formatter* formatter, const char* format, ...)
+// Splits `buffer` into arguments in place the same way GCC does - whitespace separates arguments, single and double
+// quotes group them and a backslash escapes any character. Arguments never get longer when unquoted so they're packed
+// one after another, each with a terminator, from the start of the buffer. `buffer[size]` must be writable
+static int32_t ccmd_tokenize_response_file(char* buffer, const size_t size)
 {
-    va_list args;
-    va_start(args, format);
-    const int count = ccmd_fmt_vsnprintf(formatter, format, args);
-    va_end(args);
+    const char* read = buffer;
+    const char* end = buffer + size;
+    char* write = buffer;
+    int32_t count = 0;
+
+    while (read < end)
+    {
+        while (read < end && ccmd_is_response_file_space(*read))
+        {
+            ++read;
+        }
+
+        if (read >= end)
+        {
+            break;
+        }
+
+        char quote = '\0';
+        bool escaped = false;
+        for (; read < end; ++read)
+        {
+            const char c = *read;
+            if (escaped)
+            {
+                *write++ = c;
+                escaped = false;
+            }
+            else if (c == '\\')
+            {
+                escaped = true;
+            }
+            else if (quote != '\0')
+            {
+                if (c == quote)
+                {
+                    quote = '\0';
+                }
+                else
+                {
+                    *write++ = c;
+                }
+            }
+            else if (c == '\'' || c == '"')
+            {
+                quote = c;
+            }
+            else if (ccmd_is_response_file_space(c))
+            {
+                break;
+            }
+            else
+            {
+                *write++ = c;
+            }
+        }
+
+        // step over the separator before terminating so it can't be overwritten while it's still unread
+        if (read < end)
+        {
+            ++read;
+        }
+
+        *write++ = '\0';
+        ++count;
+    }
+
     return count;
 }
 
-int ccmd_fmt_putc(struct ccmd_formatter* formatter, const char c)
+static bool ccmd_push_expanded_arg(ccmd_arg_expander* expander, char* arg)
 {
-    if (formatter->length >= formatter->buffer_capacity)
+    if (expander->argc >= expander->capacity)
     {
-        return 0;
-    }
+        // the old array stays in the arena until it's reset
+        const int32_t capacity = CPLATFORM_MAX(expander->capacity * 2, 64);
+        char** argv = (char**)ccmd_arena_alloc(expander->arena, sizeof(char*) * capacity);
+        if (argv == NULL)
+        {
+            return false;
+        }
 
-    formatter->buffer[formatter->length++] = c;
-    if (formatter->length < formatter->buffer_capacity)
-    {
-        formatter->buffer[formatter->length] = '\0';
+        if (expander->argc > 0)
+        {
+            memcpy(argv, expander->argv, sizeof(char*) * expander->argc);
+        }
+        expander->argv = argv;
+        expander->capacity = capacity;
     }
-    return 1;
+
+    expander->argv[expander->argc++] = arg;
+    return true;
 }
 
-int ccmd_fmt_puts(struct ccmd_formatter* formatter, const char* string)
+// Loads the file at `path` into writable memory with one extra zeroed byte at the end. Regular files are mapped
+// privately on top of an anonymous reservation one byte larger than the file so writes never reach the file and the
+// terminator comes for free, even if the file ends exactly on a page boundary
+static ccmd_load_status ccmd_load_response_file(ccmd_arena* arena, const char* path, char** data, size_t* size, ccmd_file_id* id)
 {
-    if (string == NULL)
+#if CPLATFORM_OS_WINDOWS == 1
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
     {
-        return 0;
+        return CCMD_LOAD_UNREADABLE;
     }
 
-    const char* ptr = string;
-    while (*ptr != '\0' && formatter->length < formatter->buffer_capacity)
+    BY_HANDLE_FILE_INFORMATION info;
+    LARGE_INTEGER file_size;
+    if (!GetFileInformationByHandle(handle, &info) || !GetFileSizeEx(handle, &file_size) || file_size.QuadPart > INT32_MAX)
     {
-        formatter->buffer[formatter->length] = *ptr;
-        ++formatter->length;
-        ++ptr;
+        CloseHandle(handle);
+        return CCMD_LOAD_UNREADABLE;
     }
 
-    if (formatter->length < formatter->buffer_capacity)
+    id->device = info.dwVolumeSerialNumber;
+    id->inode = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    *size = (size_t)file_size.QuadPart;
+    *data = (char*)ccmd_arena_alloc(arena, *size + 1);
+    if (*data == NULL)
     {
-        formatter->buffer[formatter->length] = '\0';
+        CloseHandle(handle);
+        return CCMD_LOAD_OUT_OF_MEMORY;
     }
 
-    return (int)(ptr - string);
-}
+    DWORD bytes_read = 0;
+    const BOOL success = ReadFile(handle, *data, (DWORD)*size, &bytes_read, NULL);
+    CloseHandle(handle);
+    if (!success)
+    {
+        return CCMD_LOAD_UNREADABLE;
+    }
 
-int ccmd_fmt_put_option_name(struct ccmd_formatter* formatter, const char short_name, const char* long_name)
-{
-    int count = 0;
+    *size = bytes_read;
+    (*data)[*size] = '\0';
+    return CCMD_LOAD_SUCCESS;
+#else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return CCMD_LOAD_UNREADABLE;
+    }
 
-    if (short_name != '\0')
+    struct stat info;
+    if (fstat(fd, &info) != 0)
     {
-        count += ccmd_fmt_putc(formatter, '-');
-        count += ccmd_fmt_putc(formatter, short_name);
+        close(fd);
+        return CCMD_LOAD_UNREADABLE;
     }
-    if (short_name != '\0' && long_name != NULL)
+
+    id->device = (uint64_t)info.st_dev;
+    id->inode = (uint64_t)info.st_ino;
+
+    if (S_ISREG(info.st_mode) && info.st_size > 0)
     {
-        count += ccmd_fmt_putc(formatter, '/');
+        ccmd_mapped_file* mapped = (ccmd_mapped_file*)ccmd_arena_alloc(arena, sizeof(ccmd_mapped_file));
+        if (mapped == NULL)
+        {
+            close(fd);
+            return CCMD_LOAD_OUT_OF_MEMORY;
+        }
+
+        *size = (size_t)info.st_size;
+        char* reserved = (char*)mmap(NULL, *size + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED)
+        {
+            close(fd);
+            return CCMD_LOAD_OUT_OF_MEMORY;
+        }
+
+        if (mmap(reserved, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+        {
+            munmap(reserved, *size + 1);
+            close(fd);
+            return CCMD_LOAD_UNREADABLE;
+        }
+
+        close(fd);
+        mapped->address = reserved;
+        mapped->size = *size + 1;
+        mapped->next = arena->mapped_files;
+        arena->mapped_files = mapped;
+        *data = reserved;
+        return CCMD_LOAD_SUCCESS;
     }
-    if (long_name != NULL)
+
+    // pipes and other special files can't be mapped so read them into the arena instead
+    size_t capacity = 4096;
+    *data = (char*)ccmd_arena_alloc(arena, capacity);
+    *size = 0;
+    while (*data != NULL)
     {
-        count += ccmd_fmt_puts(formatter, "--");
-        count += ccmd_fmt_puts(formatter, long_name);
+        const ssize_t bytes_read = read(fd, *data + *size, capacity - *size - 1);
+        if (bytes_read <= 0)
+        {
+            close(fd);
+            if (bytes_read < 0)
+            {
+                return CCMD_LOAD_UNREADABLE;
+            }
+
+            (*data)[*size] = '\0';
+            return CCMD_LOAD_SUCCESS;
+        }
+
+        *size += (size_t)bytes_read;
+        if (*size + 1 == capacity)
+        {
+            char* grown = (char*)ccmd_arena_alloc(arena, capacity * 2);
+            if (grown != NULL)
+            {
+                memcpy(grown, *data, *size);
+            }
+            *data = grown;
+            capacity *= 2;
+        }
     }
 
-    return count;
+    close(fd);
+    return CCMD_LOAD_OUT_OF_MEMORY;
+#endif // CPLATFORM_OS_WINDOWS == 1
 }
 
-int ccmd_fmt_spaces_base(struct ccmd_formatter* formatter, const int column_size, const int label_length)
+// Appends `argv` to the expander, replacing every @file argument with the arguments in the file. Like GCC, an @file
+// that can't be read is kept as a regular argument
+static bool ccmd_expand_response_files(ccmd_arg_expander* expander, const int32_t argc, char* const* argv)
 {
-    const int spaces = CPLATFORM_MIN(column_size - label_length, formatter->buffer_capacity - formatter->length);
-    memset(formatter->buffer + formatter->length, ' ', spaces);
-    formatter->length += spaces;
-    formatter->buffer[formatter->length] = '\0';
-    return spaces;
-}
+    for (int32_t i = 0; i < argc; ++i)
+    {
+        char* data = NULL;
+        size_t size = 0;
+        ccmd_file_id id;
+        const ccmd_load_status load_status = argv[i][0] == '@' && argv[i][1] != '\0'
+            ? ccmd_load_response_file(expander->arena, argv[i] + 1, &data, &size, &id)
+            : CCMD_LOAD_UNREADABLE;
+
+        if (load_status == CCMD_LOAD_UNREADABLE)
+        {
+            if (!ccmd_push_expanded_arg(expander, argv[i]))
+            {
+                expander->error = CCMD_RESPONSE_FILE_ERROR_ALLOCATION;
+                expander->error_path = argv[i];
+                return false;
+            }
+            continue;
+        }
 
-int ccmd_fmt_spaces_arg(struct ccmd_formatter* formatter, const int column_size, const char* name)
-{
-    return ccmd_fmt_spaces_base(formatter, column_size, (int)strlen(name));
+        expander->error_path = argv[i] + 1;
+        if (load_status == CCMD_LOAD_OUT_OF_MEMORY)
+        {
+            expander->error = CCMD_RESPONSE_FILE_ERROR_ALLOCATION;
+            return false;
+        }
+
+        for (int32_t open_file = 0; open_file < expander->depth; ++open_file)
+        {
+            if (expander->open_files[open_file].device == id.device && expander->open_files[open_file].inode == id.inode)
+            {
+                expander->error = CCMD_RESPONSE_FILE_ERROR_CYCLE;
+                return false;
+            }
+        }
+
+        if (expander->depth >= CCMD_RESPONSE_FILE_DEPTH_MAX)
+        {
+            expander->error = CCMD_RESPONSE_FILE_ERROR_DEPTH;
+            return false;
+        }
+
+        // the tokens are packed at the start of the buffer so just walk the terminators to find each one
+        const int32_t token_count = ccmd_tokenize_response_file(data, size);
+        char** tokens = (char**)ccmd_arena_alloc(expander->arena, sizeof(char*) * CPLATFORM_MAX(token_count, 1));
+        if (tokens == NULL)
+        {
+            expander->error = CCMD_RESPONSE_FILE_ERROR_ALLOCATION;
+            return false;
+        }
+
+        char* token = data;
+        for (int32_t t = 0; t < token_count; ++t)
+        {
+            tokens[t] = token;
+            token += strlen(token) + 1;
+        }
+
+        expander->open_files[expander->depth++] = id;
+        if (!ccmd_expand_response_files(expander, token_count, tokens))
+        {
+            return false;
+        }
+        --expander->depth;
+    }
+
+    return true;
 }
 
-int ccmd_fmt_spaces_opt(struct ccmd_formatter* formatter, const int column_size, const ccmd_option* option)
+/*
+ **************************
+ *
+ * Line splitting
+ *
+ **************************
+ */
+typedef enum ccmd_split_status
 {
-    return ccmd_fmt_spaces_base(formatter, column_size, ccmd_option_display_length(option));
-}
+    CCMD_SPLIT_SUCCESS,
+    CCMD_SPLIT_INVALID_QUOTING,
+    CCMD_SPLIT_TOO_MANY_ARGS
+} ccmd_split_status;
 
-static int ccmd_qsort_error_comp(const void* lhs, const void* rhs)
+static bool ccmd_is_line_space(const char c)
 {
-    const ccmd_error* lhs_error = (const ccmd_error*)lhs;
-    const ccmd_error* rhs_error = (const ccmd_error*)rhs;
-    return (int)CCMD_ERROR_KEY_CATEGORY(lhs_error->key) - (int)CCMD_ERROR_KEY_CATEGORY(rhs_error->key);
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
 }
 
-int ccmd_default_error_report(const char* program_name, ccmd_formatter* formatter, ccmd_result* result)
+// Splits `buffer` into arguments in place using POSIX shell quoting - single quotes are literal, double quotes only
+// allow \$, \`, \", \\ and line continuations to be escaped and an unquoted backslash escapes any character. Like
+// response files the arguments are packed at the start of the buffer and `buffer[length]` must be writable. If
+// `args` is NULL the arguments are only counted, otherwise they're stored as they're found. `invalid_char` is set to
+// the unterminated quote or a trailing backslash if the quoting is invalid
+static ccmd_split_status ccmd_split_line(char* buffer, const int32_t length, char** args, const int32_t capacity, int32_t* count, char* invalid_char)
 {
-    static const char* fmt_token_name[CCMD_ARGUMENT_INVALID + 1] = {
-        "option",       // CCMD_ARGUMENT_OPTION
-        "option",       // CCMD_ARGUMENT_OPTION_N_OR_MORE
-        "positional",   // CCMD_ARGUMENT_POSITIONAL
-        "subcommand",   // CCMD_ARGUMENT_SUBCOMMAND
-        "<#INVALID>",   // CCMD_ARGUMENT_INVALID
-    };
+    const char* read = buffer;
+    const char* end = buffer + length;
+    char* write = buffer;
+    *count = 0;
 
-    // sort into error categories
-    qsort(result->errors.data, result->error_count, sizeof(const ccmd_error), ccmd_qsort_error_comp);
-
-    const int old_formatter_length = formatter->length;
-    int category_progress[CCMD_ERROR_CATEGORY_COUNT][2] = { { 0, 0 } };
-    for (int i = 0; i < result->error_count; ++i)
+    while (read < end)
     {
-        ++category_progress[CCMD_ERROR_KEY_CATEGORY(result->errors.data[i].key)][1];
-    }
-
-    for (int i = 0; i < result->error_count; ++i)
-    {
-        const ccmd_error* error = &result->errors.data[i];
-        const ccmd_error_category category = CCMD_ERROR_KEY_CATEGORY(error->key);
-        const ccmd_argument_type arg_type = CCMD_ERROR_KEY_ARG_TYPE(error->key);
-        const int index_in_category = category_progress[category][0];
-        const int last_index_in_category = category_progress[category][1] - 1;
+        while (read < end && ccmd_is_line_space(*read))
+        {
+            ++read;
+        }
 
-        category_progress[category][0]++;
+        if (read >= end)
+        {
+            break;
+        }
 
-        switch (category)
+        char* arg = write;
+        char quote = '\0';
+        bool quoted = false;
+        for (; read < end; ++read)
         {
-            case CCMD_ERROR_CATEGORY_MISSING_REQUIRED_ARGUMENT:
+            const char c = *read;
+            if (quote == '\'')
             {
-                if (index_in_category == 0)
-                {
-                    ccmd_fmt(formatter, "%s: error: the following arguments are required: ", program_name);
-                }
-
-                if (arg_type == CCMD_TOKEN_SHORT_OPTION || arg_type == CCMD_TOKEN_LONG_OPTION)
+                if (c == '\'')
                 {
-                    ccmd_fmt_put_option_name(formatter, error->char8, error->str);
+                    quote = '\0';
                 }
                 else
                 {
-                    ccmd_fmt_puts(formatter, error->str);
+                    *write++ = c;
                 }
-
-                ccmd_fmt_puts(formatter, index_in_category < last_index_in_category ? ", " : "\n");
-                break;
             }
-            case CCMD_ERROR_CATEGORY_INVALID_NARGS:
+            else if (c == '\\')
             {
-                ccmd_fmt(formatter, "%s: error: option ", program_name);
-                ccmd_fmt_put_option_name(formatter, error->char8, error->str);
-
-                if (arg_type == CCMD_ARGUMENT_OPTION_N_OR_MORE)
+                if (read + 1 >= end)
                 {
-                    ccmd_fmt(formatter, " expected at least %d argument", error->int32);
+                    *invalid_char = '\\';
+                    return CCMD_SPLIT_INVALID_QUOTING;
                 }
-                else
+
+                const char next = read[1];
+                if (quote == '"' && next != '$' && next != '`' && next != '"' && next != '\\' && next != '\n')
                 {
-                    ccmd_fmt(formatter, " expected %d argument", error->int32);
+                    // not an escape inside double quotes - the backslash is kept
+                    *write++ = c;
+                    continue;
                 }
 
-                if (error->int32 > 1)
+                ++read;
+                if (next != '\n')
                 {
-                    ccmd_fmt_putc(formatter, 's'); // plural nargs
+                    *write++ = next;
                 }
-
-                ccmd_fmt_putc(formatter, '\n');
-                break;
             }
-            case CCMD_ERROR_CATEGORY_UNRECOGNIZED_ARGUMENT:
+            else if (quote == '"')
             {
-                ccmd_fmt(formatter, "%s: error; unrecognized %s: %s\n", program_name, fmt_token_name[arg_type], error->str);
-                break;
+                if (c == '"')
+                {
+                    quote = '\0';
+                }
+                else
+                {
+                    *write++ = c;
+                }
             }
-            case CCMD_ERROR_CATEGORY_INTERNAL:
+            else if (c == '\'' || c == '"')
+            {
+                quote = c;
+                quoted = true;
+            }
+            else if (ccmd_is_line_space(c))
             {
-                ccmd_fmt(formatter, "%s: error: internal error - %s\n", program_name, error->str);
                 break;
             }
-            default:
+            else
             {
-                fprintf(stderr, "%s, invalid error type: %d\n", program_name, arg_type);
-                exit(1);
+                *write++ = c;
             }
         }
-    }
-
-    return formatter->length - old_formatter_length;
-}
-
-/*
- *****************************
- *
- * Generate a usage message
- * from the command spec
- *
- *****************************
- */
-void ccmd_generate_usage(ccmd_formatter* usage_formatter, const int32_t command_count, const ccmd_command* const* commands)
-{
-    ccmd_fmt(usage_formatter, "usage: ");
 
-    const ccmd_command* executed_command = commands[command_count - 1];
-    int help_spacing = 0;
-
-    for (int i = 0; i < command_count; ++i)
-    {
-        const ccmd_command* command = commands[i];
-
-        if (command->name != NULL)
+        if (quote != '\0')
         {
-            ccmd_fmt(usage_formatter, "%s ", command->name);
+            *invalid_char = quote;
+            return CCMD_SPLIT_INVALID_QUOTING;
         }
 
-        if (command->options.count > 0)
+        if (read < end)
         {
-            // Print out all the required options
-            for (int opt_idx = 0; opt_idx < command->options.count; ++opt_idx)
-            {
-                if (command->options.data[opt_idx].required)
-                {
-                    const char* long_name = command->options.data[opt_idx].long_name;
-                    const int nargs = command->options.data[opt_idx].nargs;
-                    ccmd_fmt(usage_formatter, "--%s %s", long_name, nargs != 0 ? "ARGS " : "");
-                }
-
-                if (command == executed_command)
-                {
-                    // calculate max spacing for help strings
-                    help_spacing = CPLATFORM_MAX(help_spacing, ccmd_option_display_length(&command->options.data[opt_idx]));
-                }
-            }
-
-            ccmd_fmt(usage_formatter, "[options...] ");
+            ++read;
         }
 
-        if (command->positionals.count > 0)
+        // a line continuation on its own isn't an argument but an empty quoted string is
+        if (write == arg && !quoted)
         {
-            for (int pos_idx = 0; pos_idx < command->positionals.count; ++pos_idx)
-            {
-                // print out positionals with specific amount of spacing, i.e
-                // `program positional1 positional2 ...`
-                ccmd_fmt(usage_formatter, "%s ", command->positionals.data[pos_idx].name);
-
-                if (command == executed_command)
-                {
-                    // calculate max spacing for help strings
-                    help_spacing = CPLATFORM_MAX(help_spacing, (int)strlen(command->positionals.data[pos_idx].name));
-                }
-            }
+            continue;
         }
 
-        if (command == executed_command)
+        *write++ = '\0';
+        if (args != NULL)
         {
-            if (command->subcommands.count > 0)
+            if (*count >= capacity)
             {
-                ccmd_fmt(usage_formatter, "<command> ");
-                for (int sc = 0; sc < command->subcommands.count; ++sc)
-                {
-                    // calculate max spacing for help strings
-                    help_spacing = CPLATFORM_MAX(help_spacing, (int)strlen(command->subcommands.data[sc].name));
-                }
+                return CCMD_SPLIT_TOO_MANY_ARGS;
             }
+            args[*count] = arg;
         }
+        ++*count;
     }
 
-    if (executed_command->help != NULL)
+    return CCMD_SPLIT_SUCCESS;
+}
+
+/*
+ **************************
+ *
+ * Value conversion
+ *
+ **************************
+ */
+static uint32_t ccmd_digit_value(const char c)
+{
+    if (c >= '0' && c <= '9')
     {
-        ccmd_fmt(usage_formatter, "\n\n%s", executed_command->help);
+        return (uint32_t)(c - '0');
     }
-
-    help_spacing = CPLATFORM_MAX(CCMD_HELP_MIN_COLS, help_spacing + 4); // at least 4 spaces between the arg and the desc
-
-    // output the positional args
-    if (executed_command->positionals.count > 0)
+    if (c >= 'a' && c <= 'f')
     {
-        ccmd_fmt(usage_formatter, "\n\nArguments:\n");
+        return (uint32_t)(c - 'a' + 10);
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return (uint32_t)(c - 'A' + 10);
+    }
+    return UINT32_MAX;
+}
 
-        // print out positionals with specific amount of spacing, i.e `positional1  help string`
-        for (int pos_idx = 0; pos_idx < executed_command->positionals.count; ++pos_idx)
+// ASCII only so it's not affected by the locale
+static bool ccmd_equals_ignore_case(const char* str, const char* lowercase)
+{
+    for (; *str != '\0' && *lowercase != '\0'; ++str, ++lowercase)
+    {
+        const char c = *str >= 'A' && *str <= 'Z' ? (char)(*str - 'A' + 'a') : *str;
+        if (c != *lowercase)
         {
-            ccmd_fmt(usage_formatter, "  %s", executed_command->positionals.data[pos_idx].name);
-            ccmd_fmt_spaces_arg(usage_formatter, help_spacing, executed_command->positionals.data[pos_idx].name);
-            ccmd_fmt(usage_formatter, "%s\n", executed_command->positionals.data[pos_idx].help);
+            return false;
         }
     }
+    return *str == *lowercase;
+}
 
-    ccmd_fmt(usage_formatter, "\nOptions:\n  -h, --help");
-    ccmd_fmt_spaces_arg(usage_formatter, help_spacing, "-h, --help");
-    ccmd_fmt(usage_formatter, "Returns this help message\n");
+// Reads an unsigned decimal integer with an optional fraction. Returns the number of digits read - `fraction` holds
+// up to 18 fractional digits scaled by `fraction_scale`
+static int32_t ccmd_parse_decimal(const char** str, uint64_t* integer, uint64_t* fraction, uint64_t* fraction_scale, bool* overflow)
+{
+    const char* c = *str;
+    int32_t digits = 0;
+    *integer = 0;
+    *fraction = 0;
+    *fraction_scale = 1;
 
-    if (executed_command->options.count > 0)
+    for (; *c >= '0' && *c <= '9'; ++c, ++digits)
     {
-        // print out options, i.e `-o, --option1  help string`
-        for (int opt_idx = 0; opt_idx < executed_command->options.count; ++opt_idx)
+        const uint32_t digit = (uint32_t)(*c - '0');
+        if (*integer > (UINT64_MAX - digit) / 10)
         {
-            ccmd_fmt(usage_formatter, "  ");
-
-            // Write out short name
-            if (executed_command->options.data[opt_idx].short_name != '\0')
-            {
-                ccmd_fmt(usage_formatter, "-%c, ", executed_command->options.data[opt_idx].short_name);
-            }
-
-            // Write long name
-            ccmd_fmt(usage_formatter, "--%s", executed_command->options.data[opt_idx].long_name);
-            ccmd_fmt_spaces_opt(usage_formatter, help_spacing, &executed_command->options.data[opt_idx]);
-            // Write help string
-            ccmd_fmt(usage_formatter, "%s\n", executed_command->options.data[opt_idx].help);
+            *overflow = true;
         }
+        *integer = *integer * 10 + digit;
     }
 
-    // generate just a list of names for subcommands
-    if (executed_command->subcommands.count > 0)
+    if (*c == '.')
     {
-        ccmd_fmt(usage_formatter, "\nCommands:\n  ");
-
-        for (int cmd_idx = 0; cmd_idx < executed_command->subcommands.count; ++cmd_idx)
+        for (++c; *c >= '0' && *c <= '9'; ++c, ++digits)
         {
-            ccmd_fmt(usage_formatter, "%s", executed_command->subcommands.data[cmd_idx].name);
-
-            if (cmd_idx < executed_command->subcommands.count - 1)
+            if (*fraction_scale < UINT64_C(1000000000000000000))
             {
-                ccmd_fmt(usage_formatter, ", ");
+                *fraction = *fraction * 10 + (uint64_t)(*c - '0');
+                *fraction_scale *= 10;
             }
         }
     }
+
+    *str = c;
+    return digits;
 }
 
+// `lhs * rhs / divisor` rounded down, with the full 128 bit product so nothing is lost before the divide. The divisor
+// must be below 2^62 and the result must fit in 64 bits
+static uint64_t ccmd_mul_div(const uint64_t lhs, const uint64_t rhs, const uint64_t divisor)
+{
+    const uint64_t lhs_lo = lhs & 0xFFFFFFFFu, lhs_hi = lhs >> 32;
+    const uint64_t rhs_lo = rhs & 0xFFFFFFFFu, rhs_hi = rhs >> 32;
+    const uint64_t lo_lo = lhs_lo * rhs_lo;
+    const uint64_t cross = (lo_lo >> 32) + (lhs_hi * rhs_lo & 0xFFFFFFFFu) + lhs_lo * rhs_hi;
+    const uint64_t product_hi = lhs_hi * rhs_hi + (lhs_hi * rhs_lo >> 32) + (cross >> 32);
+    const uint64_t product_lo = (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+
+    uint64_t quotient = 0;
+    uint64_t remainder = 0;
+    for (int bit = 127; bit >= 0; --bit)
+    {
+        remainder = (remainder << 1) | ((bit >= 64 ? product_hi >> (bit - 64) : product_lo >> bit) & 1);
+        quotient <<= 1;
+        if (remainder >= divisor)
+        {
+            remainder -= divisor;
+            quotient |= 1;
+        }
+    }
+    return quotient;
+}
 
-/*
- *****************************
- *
- * Subcommand/root command
- * parsing API
- *
- *****************************
- */
-ccmd_token ccmd_parse_element(const ccmd_parser* parser, const char* arg)
+// `integer.fraction * unit` checking for overflow. The fraction is scaled exactly so i.e. '0.001kb' is one byte
+static bool ccmd_scale_decimal(const uint64_t integer, const uint64_t fraction, const uint64_t fraction_scale, const uint64_t unit, uint64_t* result)
 {
-    if (arg == NULL)
+    if (unit != 0 && integer > UINT64_MAX / unit)
     {
-        return (ccmd_token) { .type = CCMD_TOKEN_INVALID };
+        return false;
     }
 
-    int leading_dashes = 0;
-    int length = 0;
-    for (; arg[length] != '\0'; ++length)
+    const uint64_t scaled_fraction = ccmd_mul_div(fraction, unit, fraction_scale);
+    if (integer * unit > UINT64_MAX - scaled_fraction)
     {
-        if (arg[length] == '-' && length == leading_dashes)
-        {
-            ++leading_dashes;
-        }
+        return false;
     }
 
-    if (length == 0)
+    *result = integer * unit + scaled_fraction;
+    return true;
+}
+
+static bool ccmd_parse_int64(const char* str, int64_t* value)
+{
+    const char* c = str;
+    const bool negative = *c == '-';
+    if (*c == '-' || *c == '+')
     {
-        return (ccmd_token) { .type = CCMD_TOKEN_INVALID };
+        ++c;
     }
 
-    if (leading_dashes == 1)
+    uint32_t base = 10;
+    if (c[0] == '0' && (c[1] == 'x' || c[1] == 'X'))
     {
-        return (ccmd_token) { .type = CCMD_TOKEN_SHORT_OPTION, .value = arg + 1, .length = 1 };
+        base = 16;
+        c += 2;
     }
 
-    if (leading_dashes == 2)
+    if (*c == '\0')
     {
-        // A solitary '--' argument indicates the command line should stop parsing
-        const ccmd_token_type type = length == 2 ? CCMD_TOKEN_DELIMITER : CCMD_TOKEN_LONG_OPTION;
-        return (ccmd_token) { .type = type, .value = arg + 2, .length = length - 2 };
+        return false;
     }
 
-    const ccmd_command_result* command_result = parser->command_result;
-    const ccmd_command* command_info = parser->command_infos[parser->program_result->commands_count - 1];
-    const ccmd_command_result* subcommand = &parser->program_result->commands.data[parser->program_result->commands_count - 1];
-    const bool all_positionals_parsed = command_result->positionals.count >= command_info->positionals.count;
-    const bool has_parsed_subcommands = subcommand > parser->command_result;
+    uint64_t magnitude = 0;
+    for (; *c != '\0'; ++c)
+    {
+        const uint32_t digit = ccmd_digit_value(*c);
+        if (digit >= base || magnitude > (UINT64_MAX - digit) / base)
+        {
+            return false;
+        }
+        magnitude = magnitude * base + digit;
+    }
 
-    return (ccmd_token) {
-        .type = (all_positionals_parsed && !has_parsed_subcommands)  ? CCMD_TOKEN_SUBCOMMAND : CCMD_TOKEN_POSITIONAL,
-        .value = arg,
-        .length = length
-    };
+    if (magnitude > (negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX))
+    {
+        return false;
+    }
+
+    *value = negative ? (magnitude > (uint64_t)INT64_MAX ? INT64_MIN : -(int64_t)magnitude) : (int64_t)magnitude;
+    return true;
 }
 
-bool ccmd_compare_option(const ccmd_token* element, const char expected_short_name, const char* expected_long_name)
+// More digits than the 767 significant digits any point halfway between two doubles can have, so digits past this
+// can only ever break a tie
+#define CCMD_DOUBLE_DIGITS_MAX 800
+// Enough for the largest numbers ccmd_parse_double_exact works with: 10^1130 shifted up by 54 bits
+#define CCMD_BIGNUM_WORDS 128
+
+typedef struct ccmd_bignum
+{
+    int32_t     count;
+    uint32_t    words[CCMD_BIGNUM_WORDS]; // least significant first
+} ccmd_bignum;
+
+static void ccmd_bignum_mul_add(ccmd_bignum* bignum, const uint32_t multiplier, const uint32_t addend)
 {
-    if (element->type != CCMD_TOKEN_SHORT_OPTION && element->type != CCMD_TOKEN_LONG_OPTION)
+    uint64_t carry = addend;
+    for (int32_t i = 0; i < bignum->count; ++i)
     {
-        return false;
+        carry += (uint64_t)bignum->words[i] * multiplier;
+        bignum->words[i] = (uint32_t)carry;
+        carry >>= 32;
     }
-
-    if (element->length == 1 && element->value[0] == expected_short_name)
+    if (carry != 0)
     {
-        return true;
+        bignum->words[bignum->count++] = (uint32_t)carry;
     }
+}
 
-    return strncmp(expected_long_name, element->value, element->length) == 0;
+static void ccmd_bignum_mul_pow10(ccmd_bignum* bignum, int32_t exponent)
+{
+    for (; exponent >= 9; exponent -= 9)
+    {
+        ccmd_bignum_mul_add(bignum, 1000000000u, 0);
+    }
+    for (; exponent > 0; --exponent)
+    {
+        ccmd_bignum_mul_add(bignum, 10u, 0);
+    }
 }
 
-int ccmd_find_option(const ccmd_command* command, const ccmd_token* element)
+static void ccmd_bignum_shift_left(ccmd_bignum* bignum, const int32_t bits)
 {
-    for (int i = 0; i < command->options.count; ++i)
+    const int32_t words = bits / 32;
+    const int32_t shift = bits % 32;
+    if (bignum->count == 0)
     {
-        if (ccmd_compare_option(element, command->options.data[i].short_name, command->options.data[i].long_name))
-        {
-            return i;
-        }
+        return;
     }
 
-    return -1;
+    bignum->words[bignum->count + words] = 0;
+    for (int32_t i = bignum->count - 1; i >= 0; --i)
+    {
+        const uint64_t shifted = (uint64_t)bignum->words[i] << shift;
+        bignum->words[i + words + 1] |= (uint32_t)(shifted >> 32);
+        bignum->words[i + words] = (uint32_t)shifted;
+    }
+    memset(bignum->words, 0, sizeof(uint32_t) * words);
+    bignum->count += words + 1;
+    while (bignum->count > 0 && bignum->words[bignum->count - 1] == 0)
+    {
+        --bignum->count;
+    }
 }
 
-ccmd_status ccmd_parse_command(const int argc, char* const* argv, ccmd_parser* parser)
+static void ccmd_bignum_shift_right_1(ccmd_bignum* bignum)
 {
-    assert(parser->program_result->commands_count < parser->program_result->commands.count);
-
-    // get command info
-    const ccmd_command* command_info = parser->command_infos[parser->program_result->commands_count - 1];
-    ccmd_command_result* command_result = parser->command_result;
+    for (int32_t i = 0; i < bignum->count; ++i)
+    {
+        const uint32_t next = i + 1 < bignum->count ? bignum->words[i + 1] : 0;
+        bignum->words[i] = (bignum->words[i] >> 1) | (next << 31);
+    }
+    if (bignum->count > 0 && bignum->words[bignum->count - 1] == 0)
+    {
+        --bignum->count;
+    }
+}
 
-    // setup parser
-    const int max_errors = parser->program_result->errors.count;
-    const ccmd_error* errors = parser->program_result->errors.data;
-    for (int i = 0; i < command_info->positionals.count && parser->program_result->error_count < max_errors; ++i)
+static int ccmd_bignum_compare(const ccmd_bignum* lhs, const ccmd_bignum* rhs)
+{
+    if (lhs->count != rhs->count)
     {
-        ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_MISSING_REQUIRED_ARGUMENT, CCMD_ARGUMENT_POSITIONAL,
-            '\0', command_info->positionals.data[i].name, 1
-        );
+        return lhs->count < rhs->count ? -1 : 1;
     }
-    for (int i = 0; i < command_info->options.count && parser->program_result->error_count < max_errors; ++i)
+    for (int32_t i = lhs->count - 1; i >= 0; --i)
     {
-        if (!command_info->options.data[i].required)
+        if (lhs->words[i] != rhs->words[i])
         {
-            continue;
+            return lhs->words[i] < rhs->words[i] ? -1 : 1;
         }
-
-        ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_MISSING_REQUIRED_ARGUMENT, CCMD_ARGUMENT_OPTION,
-            command_info->options.data[i].short_name,
-            command_info->options.data[i].long_name,
-            command_info->options.data[i].nargs
-        );
     }
+    return 0;
+}
 
-    // setup command defaults - name and run callback
-    memset(command_result, 0, sizeof(ccmd_command_result));
-    if (command_info->name != NULL)
+// `lhs` must be at least as large as `rhs`
+static void ccmd_bignum_subtract(ccmd_bignum* lhs, const ccmd_bignum* rhs)
+{
+    int64_t borrow = 0;
+    for (int32_t i = 0; i < lhs->count; ++i)
     {
-        command_result->name = command_info->name;
+        const int64_t difference = (int64_t)lhs->words[i] - (i < rhs->count ? rhs->words[i] : 0) - borrow;
+        borrow = difference < 0 ? 1 : 0;
+        lhs->words[i] = (uint32_t)(difference + (borrow << 32));
     }
+    while (lhs->count > 0 && lhs->words[lhs->count - 1] == 0)
+    {
+        --lhs->count;
+    }
+}
 
-    if (command_info->run != NULL)
+static int32_t ccmd_bignum_bits(const ccmd_bignum* bignum)
+{
+    if (bignum->count == 0)
     {
-        command_result->run = command_info->run;
+        return 0;
     }
 
-    int nargs_parsed = 0;
+    int32_t bits = (bignum->count - 1) * 32;
+    for (uint32_t top = bignum->words[bignum->count - 1]; top != 0; top >>= 1)
+    {
+        ++bits;
+    }
+    return bits;
+}
 
-    while (nargs_parsed < argc)
+// Correctly rounded conversion for anything the fast path in ccmd_parse_double can't do exactly. `str` has already
+// been validated. The digits are read into an integer N and the value is N / M (or N * M) for a power of ten M, which
+// is divided out in binary to get 53 bits of quotient - the remainder then decides the rounding
+static bool ccmd_parse_double_exact(const char* str, const bool negative, double* value)
+{
+    const char* c = str + (*str == '-' || *str == '+' ? 1 : 0);
+
+    ccmd_bignum numerator = { 0 };
+    int32_t digits = 0;
+    int32_t exponent = 0;
+    bool truncated = false;
+    uint32_t chunk = 0;
+    uint32_t chunk_scale = 1;
+    for (bool fraction = false; (*c >= '0' && *c <= '9') || (*c == '.' && !fraction); ++c)
     {
-        char* const* argv_slice = argv + nargs_parsed;
-        const ccmd_token token = ccmd_parse_element(parser, argv[nargs_parsed++]);
+        if (*c == '.')
+        {
+            fraction = true;
+            continue;
+        }
 
-        switch (token.type)
+        if (digits == 0 && *c == '0')
         {
-            case CCMD_TOKEN_INVALID:
-            {
-                // very dodgy - something went terribly wrong
-                ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INTERNAL, CCMD_ARGUMENT_INVALID,
-                    '\0', "invalid argument string detected", 0
-                );
+            exponent -= fraction ? 1 : 0;
+            continue;
+        }
+
+        if (digits >= CCMD_DOUBLE_DIGITS_MAX)
+        {
+            truncated |= *c != '0';
+            exponent += fraction ? 0 : 1;
+            continue;
+        }
+
+        // batch nine digits at a time into each multiply
+        chunk = chunk * 10 + (uint32_t)(*c - '0');
+        chunk_scale *= 10;
+        if (chunk_scale == 1000000000u)
+        {
+            ccmd_bignum_mul_add(&numerator, chunk_scale, chunk);
+            chunk = 0;
+            chunk_scale = 1;
+        }
+        ++digits;
+        exponent -= fraction ? 1 : 0;
+    }
+    if (chunk_scale > 1)
+    {
+        ccmd_bignum_mul_add(&numerator, chunk_scale, chunk);
+    }
+
+    if (*c == 'e' || *c == 'E')
+    {
+        ++c;
+        const bool negative_exponent = *c == '-';
+        c += *c == '-' || *c == '+' ? 1 : 0;
+
+        int32_t explicit_exponent = 0;
+        for (; *c >= '0' && *c <= '9'; ++c)
+        {
+            explicit_exponent = CPLATFORM_MIN(explicit_exponent * 10 + (*c - '0'), 100000);
+        }
+        exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+    }
+
+    // anything at or above 10^309 overflows and anything below 10^-325 rounds to zero
+    const int32_t magnitude = digits + exponent;
+    if (numerator.count == 0 || magnitude < -324)
+    {
+        *value = negative ? -0.0 : 0.0;
+        return true;
+    }
+    if (magnitude > 309)
+    {
+        return false;
+    }
+
+    ccmd_bignum divisor = { 1, { 1 } };
+    if (exponent >= 0)
+    {
+        ccmd_bignum_mul_pow10(&numerator, exponent);
+    }
+    else
+    {
+        ccmd_bignum_mul_pow10(&divisor, -exponent);
+    }
+
+    // pick the binary scale that leaves 53 bits of quotient, or fewer for subnormals which are all scaled by 2^-1074
+    int32_t scale = 52 + ccmd_bignum_bits(&divisor) - ccmd_bignum_bits(&numerator);
+    ccmd_bignum scaled = numerator;
+    ccmd_bignum lower_bound = divisor;
+    ccmd_bignum_shift_left(&lower_bound, 52);
+    if (scale >= 0)
+    {
+        ccmd_bignum_shift_left(&scaled, scale);
+    }
+    else
+    {
+        ccmd_bignum_shift_left(&lower_bound, -scale);
+    }
+    if (ccmd_bignum_compare(&scaled, &lower_bound) < 0)
+    {
+        ++scale;
+    }
+    scale = CPLATFORM_MIN(scale, 1074);
+
+    ccmd_bignum remainder = numerator;
+    ccmd_bignum step = divisor;
+    if (scale >= 0)
+    {
+        ccmd_bignum_shift_left(&remainder, scale);
+    }
+    else
+    {
+        ccmd_bignum_shift_left(&step, -scale);
+    }
+
+    // binary long division - the quotient is known to be below 2^53
+    uint64_t quotient = 0;
+    ccmd_bignum_shift_left(&step, 52);
+    for (int32_t bit = 52; bit >= 0; --bit)
+    {
+        if (ccmd_bignum_compare(&remainder, &step) >= 0)
+        {
+            ccmd_bignum_subtract(&remainder, &step);
+            quotient |= UINT64_C(1) << bit;
+        }
+        ccmd_bignum_shift_right_1(&step);
+    }
+
+    // round half to even, where any digits that were dropped put the value just past the halfway point
+    ccmd_bignum half = divisor;
+    if (scale < 0)
+    {
+        ccmd_bignum_shift_left(&half, -scale);
+    }
+    ccmd_bignum_shift_left(&remainder, 1);
+    const int halfway = ccmd_bignum_compare(&remainder, &half);
+    if (halfway > 0 || (halfway == 0 && (truncated || (quotient & 1) != 0)))
+    {
+        ++quotient;
+    }
+
+    // the largest double is just under 2^1024
+    if (quotient >= (UINT64_C(1) << 53))
+    {
+        quotient >>= 1;
+        --scale;
+    }
+    if (53 - scale > 1024)
+    {
+        return false;
+    }
+
+    const double result = ldexp((double)quotient, -scale);
+    *value = negative ? -result : result;
+    return true;
+}
+
+static bool ccmd_parse_double(const char* str, double* value)
+{
+    // every power of ten up to 1e22 is exactly representable as a double
+    static const double exact_powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* c = str;
+    const bool negative = *c == '-';
+    if (*c == '-' || *c == '+')
+    {
+        ++c;
+    }
+
+    if (ccmd_equals_ignore_case(c, "inf") || ccmd_equals_ignore_case(c, "infinity"))
+    {
+        *value = negative ? -HUGE_VAL : HUGE_VAL;
+        return true;
+    }
+
+    if (ccmd_equals_ignore_case(c, "nan"))
+    {
+        *value = NAN;
+        return true;
+    }
+
+    // gather up to 19 significant digits - any more and the result can't be computed exactly here
+    uint64_t mantissa = 0;
+    int32_t significant_digits = 0;
+    int32_t exponent = 0;
+    bool any_digits = false;
+    bool truncated = false;
+    for (; *c >= '0' && *c <= '9'; ++c)
+    {
+        any_digits = true;
+        if (significant_digits < 19)
+        {
+            mantissa = mantissa * 10 + (uint64_t)(*c - '0');
+            significant_digits += mantissa > 0 ? 1 : 0;
+        }
+        else
+        {
+            truncated |= *c != '0';
+            ++exponent;
+        }
+    }
+
+    if (*c == '.')
+    {
+        for (++c; *c >= '0' && *c <= '9'; ++c)
+        {
+            any_digits = true;
+            if (significant_digits < 19)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*c - '0');
+                significant_digits += mantissa > 0 ? 1 : 0;
+                --exponent;
+            }
+            else
+            {
+                truncated |= *c != '0';
+            }
+        }
+    }
+
+    if (!any_digits)
+    {
+        return false;
+    }
+
+    if (*c == 'e' || *c == 'E')
+    {
+        ++c;
+        const bool negative_exponent = *c == '-';
+        if (*c == '-' || *c == '+')
+        {
+            ++c;
+        }
+
+        if (*c < '0' || *c > '9')
+        {
+            return false;
+        }
+
+        int32_t explicit_exponent = 0;
+        for (; *c >= '0' && *c <= '9'; ++c)
+        {
+            explicit_exponent = CPLATFORM_MIN(explicit_exponent * 10 + (*c - '0'), 100000);
+        }
+        exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+    }
+
+    if (*c != '\0')
+    {
+        return false;
+    }
+
+    // fast path - both the mantissa and power of ten are exact so a single multiply/divide rounds correctly
+    if (!truncated && mantissa <= (UINT64_C(1) << 53) && exponent >= -22 && exponent <= 22)
+    {
+        const double result = exponent < 0
+            ? (double)mantissa / exact_powers[-exponent]
+            : (double)mantissa * exact_powers[exponent];
+        *value = negative ? -result : result;
+        return true;
+    }
+
+    return ccmd_parse_double_exact(str, negative, value);
+}
+
+static bool ccmd_parse_bool(const char* str, bool* value)
+{
+    static const char* true_names[] = { "true", "yes", "on", "1" };
+    static const char* false_names[] = { "false", "no", "off", "0" };
+
+    for (int i = 0; i < (int)CCMD_ARRAY_SIZE(true_names); ++i)
+    {
+        if (ccmd_equals_ignore_case(str, true_names[i]))
+        {
+            *value = true;
+            return true;
+        }
+
+        if (ccmd_equals_ignore_case(str, false_names[i]))
+        {
+            *value = false;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool ccmd_parse_size(const char* str, uint64_t* value)
+{
+    typedef struct ccmd_size_unit { const char* name; uint64_t bytes; } ccmd_size_unit;
+    static const ccmd_size_unit units[] = {
+        { "", 1 },          { "b", 1 },
+        { "k", 1ull << 10 },{ "kib", 1ull << 10 },  { "kb", 1000ull },
+        { "m", 1ull << 20 },{ "mib", 1ull << 20 },  { "mb", 1000000ull },
+        { "g", 1ull << 30 },{ "gib", 1ull << 30 },  { "gb", 1000000000ull },
+        { "t", 1ull << 40 },{ "tib", 1ull << 40 },  { "tb", 1000000000000ull },
+        { "p", 1ull << 50 },{ "pib", 1ull << 50 },  { "pb", 1000000000000000ull },
+        { "e", 1ull << 60 },{ "eib", 1ull << 60 },  { "eb", 1000000000000000000ull },
+    };
+
+    const char* c = str;
+    uint64_t integer = 0, fraction = 0, fraction_scale = 1;
+    bool overflow = false;
+    if (ccmd_parse_decimal(&c, &integer, &fraction, &fraction_scale, &overflow) == 0 || overflow)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < (int)CCMD_ARRAY_SIZE(units); ++i)
+    {
+        if (ccmd_equals_ignore_case(c, units[i].name))
+        {
+            return ccmd_scale_decimal(integer, fraction, fraction_scale, units[i].bytes, value);
+        }
+    }
+
+    return false;
+}
+
+static bool ccmd_parse_duration(const char* str, int64_t* value)
+{
+    typedef struct ccmd_duration_unit { const char* name; int32_t length; uint64_t nanoseconds; } ccmd_duration_unit;
+    static const ccmd_duration_unit units[] = {
+        // longest names first so 'ms' isn't read as 'm'
+        { "ns", 2, 1ull },
+        { "us", 2, 1000ull },
+        { "\xc2\xb5s", 3, 1000ull }, // µs
+        { "ms", 2, 1000000ull },
+        { "s", 1, 1000000000ull },
+        { "m", 1, 60000000000ull },
+        { "h", 1, 3600000000000ull },
+        { "d", 1, 86400000000000ull },
+    };
+
+    const char* c = str;
+    const bool negative = *c == '-';
+    if (*c == '-' || *c == '+')
+    {
+        ++c;
+    }
+
+    // a unit is required for anything but zero
+    if (c[0] == '0' && c[1] == '\0')
+    {
+        *value = 0;
+        return true;
+    }
+
+    if (*c == '\0')
+    {
+        return false;
+    }
+
+    uint64_t total = 0;
+    while (*c != '\0')
+    {
+        uint64_t integer = 0, fraction = 0, fraction_scale = 1;
+        bool overflow = false;
+        if (ccmd_parse_decimal(&c, &integer, &fraction, &fraction_scale, &overflow) == 0 || overflow)
+        {
+            return false;
+        }
+
+        const ccmd_duration_unit* unit = NULL;
+        for (int i = 0; i < (int)CCMD_ARRAY_SIZE(units) && unit == NULL; ++i)
+        {
+            if (strncmp(c, units[i].name, units[i].length) == 0)
+            {
+                unit = &units[i];
+            }
+        }
+
+        uint64_t nanoseconds = 0;
+        if (unit == NULL || !ccmd_scale_decimal(integer, fraction, fraction_scale, unit->nanoseconds, &nanoseconds))
+        {
+            return false;
+        }
+
+        if (total > UINT64_MAX - nanoseconds)
+        {
+            return false;
+        }
+
+        total += nanoseconds;
+        c += unit->length;
+    }
+
+    if (total > (negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX))
+    {
+        return false;
+    }
+
+    *value = negative ? (total > (uint64_t)INT64_MAX ? INT64_MIN : -(int64_t)total) : (int64_t)total;
+    return true;
+}
+
+static bool ccmd_parse_value(const ccmd_value_type type, const char* str, ccmd_value* value)
+{
+    switch (type)
+    {
+        case CCMD_VALUE_INT64: return ccmd_parse_int64(str, &value->int64);
+        case CCMD_VALUE_DOUBLE: return ccmd_parse_double(str, &value->float64);
+        case CCMD_VALUE_BOOL: return ccmd_parse_bool(str, &value->boolean);
+        case CCMD_VALUE_SIZE: return ccmd_parse_size(str, &value->size);
+        case CCMD_VALUE_DURATION: return ccmd_parse_duration(str, &value->duration_ns);
+        default: return false;
+    }
+}
+
+/*
+ **************************
+ *
+ * Utils API
+ *
+ **************************
+ */
+#if defined(CCMD_ENABLE_INSTRUMENTATION)
+static int64_t ccmd_now_ns(void)
+{
+#if CPLATFORM_OS_WINDOWS == 1
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (int64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + (int64_t)ts.tv_nsec;
+#endif // CPLATFORM_OS_WINDOWS == 1
+}
+#endif // defined(CCMD_ENABLE_INSTRUMENTATION)
+
+int ccmd_option_display_length(const ccmd_option* opt)
+{
+    int size = 2; // 2 extra for '--'
+    if (opt->long_name != NULL)
+    {
+        size += (int)strlen(opt->long_name);
+    }
+    if (opt->short_name != '\0')
+    {
+        size += 4; // 3 extra for the leading '-' and trailing ', '
+    }
+    return size;
+}
+
+ccmd_parsed_args* add_option(ccmd_parser* parser)
+{
+    const int index = parser->program_result->option_count;
+    if (index >= parser->program_result->options.count)
+    {
+        // out of space - the caller decides how to report it
+        return NULL;
+    }
+
+    ++parser->program_result->option_count;
+    ++parser->command_result->options.count;
+
+    if (parser->command_result->options.data == NULL)
+    {
+        parser->command_result->options.data = &parser->program_result->options.data[index];
+    }
+
+    return &parser->program_result->options.data[index];
+}
+
+static bool ccmd_option_has_values(const ccmd_option* option)
+{
+    return option->value_type != CCMD_VALUE_STRING || option->choices.count > 0;
+}
+
+static bool ccmd_command_has_choices(const ccmd_command* command)
+{
+    for (int i = 0; i < command->options.count; ++i)
+    {
+        if (command->options.data[i].choices.count > 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static ccmd_value* ccmd_alloc_values(ccmd_parser* parser, const int32_t count)
+{
+    ccmd_result* result = parser->program_result;
+    if (result->arena != NULL)
+    {
+        return (ccmd_value*)ccmd_arena_alloc(result->arena, sizeof(ccmd_value) * count);
+    }
+
+    if (result->values.data == NULL || parser->value_count + count > result->values.count)
+    {
+        return NULL;
+    }
+
+    ccmd_value* values = &result->values.data[parser->value_count];
+    parser->value_count += count;
+    return values;
+}
+
+static void ccmd_store_value(void* field, const ccmd_option* option, char* arg, const ccmd_value* value)
+{
+    if (option->choices.count > 0)
+    {
+        memcpy(field, &value->choice, sizeof(value->choice));
+        return;
+    }
+
+    switch (option->value_type)
+    {
+        case CCMD_VALUE_STRING: memcpy(field, &arg, sizeof(const char*)); break;
+        case CCMD_VALUE_INT64: memcpy(field, &value->int64, sizeof(value->int64)); break;
+        case CCMD_VALUE_DOUBLE: memcpy(field, &value->float64, sizeof(value->float64)); break;
+        case CCMD_VALUE_BOOL: memcpy(field, &value->boolean, sizeof(value->boolean)); break;
+        case CCMD_VALUE_SIZE: memcpy(field, &value->size, sizeof(value->size)); break;
+        case CCMD_VALUE_DURATION: memcpy(field, &value->duration_ns, sizeof(value->duration_ns)); break;
+        default: break;
+    }
+}
+
+static int32_t ccmd_find_choice(const ccmd_option* option, const ccmd_hash_table* table, const char* arg);
+
+// Converts an already validated argument if the result had nowhere to store its values while parsing
+static const ccmd_value* ccmd_action_value(const ccmd_option* option, char* const* args, const ccmd_value* values, const int32_t index, ccmd_value* scratch)
+{
+    if (values != NULL || !ccmd_option_has_values(option))
+    {
+        return values != NULL ? &values[index] : NULL;
+    }
+
+    if (option->choices.count > 0)
+    {
+        scratch->choice = ccmd_find_choice(option, NULL, args[index]);
+    }
+    else
+    {
+        ccmd_parse_value(option->value_type, args[index], scratch);
+    }
+    return scratch;
+}
+
+// Writes a parsed option into the result's destination struct. Returns false if an append list is full
+static bool ccmd_apply_action(ccmd_result* result, const ccmd_option* option, char* const* args, const ccmd_value* values, const int32_t nargs)
+{
+    if (result->destination == NULL || option->action == CCMD_ACTION_NONE)
+    {
+        return true;
+    }
+
+    // memcpy rather than casts as the field may not be aligned for the type
+    void* field = (char*)result->destination + option->offset;
+    switch (option->action)
+    {
+        case CCMD_ACTION_STORE_TRUE:
+        case CCMD_ACTION_STORE_FALSE:
+        {
+            const bool flag = option->action == CCMD_ACTION_STORE_TRUE;
+            memcpy(field, &flag, sizeof(flag));
+            break;
+        }
+        case CCMD_ACTION_COUNT:
+        {
+            int32_t count = 0;
+            memcpy(&count, field, sizeof(count));
+            ++count;
+            memcpy(field, &count, sizeof(count));
+            break;
+        }
+        case CCMD_ACTION_STORE_VALUE:
+        {
+            if (nargs > 0)
+            {
+                ccmd_value scratch;
+                ccmd_store_value(field, option, args[0], ccmd_action_value(option, args, values, 0, &scratch));
+            }
+            break;
+        }
+        case CCMD_ACTION_APPEND:
+        {
+            ccmd_append_list* list = (ccmd_append_list*)field;
+            if (list->count + nargs > list->capacity)
+            {
+                return false;
+            }
+
+            for (int i = 0; i < nargs; ++i, ++list->count)
+            {
+                ccmd_value scratch;
+                const ccmd_value* value = ccmd_action_value(option, args, values, i, &scratch);
+                if (value != NULL)
+                {
+                    list->values[list->count] = *value;
+                }
+                else
+                {
+                    list->strings[list->count] = args[i];
+                }
+            }
+            break;
+        }
+        default: break;
+    }
+
+    return true;
+}
+
+// Returns the stored error or NULL if there was no room for it
+ccmd_error* ccmd_add_error(ccmd_result* result, ccmd_error_category category, enum ccmd_argument_type arg_type, const char char8, const char* str, const int32_t int32)
+{
+    if (result->errors.count <= 0)
+    {
+        CCMD_INSTRUMENT_ADD(result, errors_dropped, 1);
+        return NULL;
+    }
+
+    ccmd_error* stored = NULL;
+    if (result->error_count >= result->errors.count)
+    {
+        CCMD_INSTRUMENT_ADD(result, errors_dropped, 1);
+
+        // out of space - replace the last error with a note that some were dropped
+        stored = &result->errors.data[result->errors.count - 1];
+        if (stored->key == CCMD_ERROR_KEY(CCMD_ERROR_CATEGORY_INTERNAL, CCMD_ARGUMENT_INVALID))
+        {
+            return NULL;
+        }
+
+        stored->key = CCMD_ERROR_KEY(CCMD_ERROR_CATEGORY_INTERNAL, CCMD_ARGUMENT_INVALID);
+        stored->char8 = '\0';
+        stored->str = "too many errors were generated";
+        stored->int32 = 0;
+        stored->value = NULL;
+        stored->command = NULL;
+        stored->suggestion = NULL;
+        return NULL;
+    }
+
+    CCMD_INSTRUMENT_ADD(result, errors_added, 1);
+    stored = &result->errors.data[result->error_count++];
+    stored->key = CCMD_ERROR_KEY(category, arg_type);
+    stored->char8 = char8;
+    stored->str = str;
+    stored->int32 = int32;
+    stored->value = NULL;
+    stored->command = NULL;
+    stored->suggestion = NULL;
+    return stored;
+}
+
+static int32_t ccmd_max_command_errors(const ccmd_command* command)
+{
+    // errors never carry over into a subcommand so the worst case is every missing positional/required option of a
+    // single command plus the error that stopped parsing
+    int32_t command_errors = command->positionals.count + 1;
+    for (int i = 0; i < command->options.count; ++i)
+    {
+        command_errors += command->options.data[i].required ? 1 : 0;
+    }
+    return command_errors;
+}
+
+// Most options a single argument can hold - one for each letter of a short cluster or one for anything else
+static int32_t ccmd_max_argument_options(const char* arg, const int32_t length)
+{
+    return arg[0] == '-' && length > 2 && arg[1] != '-' ? length - 1 : 1;
+}
+
+// Most options that parsing `argv` can store, skipping the program name in argv[0]. Only arguments starting with a
+// dash can be options
+static int32_t ccmd_max_command_line_options(const int32_t argc, char* const* argv)
+{
+    int32_t options = 0;
+    for (int32_t i = 1; i < argc; ++i)
+    {
+        options += argv[i][0] == '-' ? ccmd_max_argument_options(argv[i], (int32_t)strlen(argv[i])) : 0;
+    }
+    return options;
+}
+
+static ccmd_capacity ccmd_capacity_for_argc(const int32_t max_depth, const int32_t max_command_errors, const int32_t max_path_options, const bool has_values, const int32_t argc, const int32_t options)
+{
+    // every subcommand and option argument consumes at least one argument so argc bounds them
+    const int32_t args = CPLATFORM_MAX(argc - 1, 0);
+    ccmd_capacity capacity;
+    capacity.commands = CPLATFORM_MIN(max_depth, args + 1);
+    capacity.options = CPLATFORM_MAX(options, 1);
+    capacity.errors = max_command_errors;
+    capacity.option_ids = max_path_options;
+    capacity.values = has_values ? args : 0;
+    capacity.usage_bytes = 0;
+    return capacity;
+}
+
+/*
+ **************************
+ *
+ * String formatter API
+ *
+ **************************
+ */
+// Strings at least this long are referenced by a chunk rather than copied into the buffer when streaming
+#define CCMD_FMT_CHUNK_MIN_LENGTH 64
+
+static void ccmd_fmt_end_chunk(struct ccmd_formatter* formatter)
+{
+    if (formatter->length > formatter->chunk_begin)
+    {
+        formatter->chunks[formatter->chunk_count++] = (ccmd_write_chunk) {
+            formatter->buffer + formatter->chunk_begin,
+            formatter->length - formatter->chunk_begin
+        };
+        formatter->chunk_begin = formatter->length;
+    }
+}
+
+// Writes everything buffered so far to the sink, if there is one, and empties the buffer
+void ccmd_fmt_flush(struct ccmd_formatter* formatter)
+{
+    if (formatter->sink == NULL)
+    {
+        return;
+    }
+
+    assert(formatter->chunks != NULL && formatter->chunk_capacity >= 2);
+    ccmd_fmt_end_chunk(formatter);
+
+    const ccmd_writer* sink = formatter->sink;
+    if (sink->write_chunks != NULL && formatter->chunk_count > 0)
+    {
+        sink->write_chunks(sink->user_data, formatter->chunks, formatter->chunk_count);
+    }
+    else if (sink->write != NULL)
+    {
+        for (int32_t i = 0; i < formatter->chunk_count; ++i)
+        {
+            sink->write(sink->user_data, formatter->chunks[i].data, formatter->chunks[i].length);
+        }
+    }
+
+    for (int32_t i = 0; i < formatter->chunk_count; ++i)
+    {
+        formatter->flushed += formatter->chunks[i].length;
+    }
+
+    formatter->chunk_count = 0;
+    formatter->chunk_begin = 0;
+    formatter->length = 0;
+    formatter->buffer[0] = '\0';
+}
+
+// Total number of bytes written, including any that were already flushed
+int32_t ccmd_fmt_total(const struct ccmd_formatter* formatter)
+{
+    int32_t total = formatter->flushed + formatter->length;
+    for (int32_t i = 0; i < formatter->chunk_count; ++i)
+    {
+        // referenced strings aren't in the buffer so they aren't counted by `length`
+        const char* data = formatter->chunks[i].data;
+        total += data < formatter->buffer || data >= formatter->buffer + formatter->buffer_capacity ? formatter->chunks[i].length : 0;
+    }
+    return total;
+}
+
+// Returns the number of bytes that can be written before the buffer is full, flushing first if streaming and there's
+// less than `required` available
+static int32_t ccmd_fmt_available(struct ccmd_formatter* formatter, const int32_t required)
+{
+    // always leave room for the terminator
+    int32_t available = formatter->buffer_capacity - formatter->length - 1;
+    if (available < required && formatter->sink != NULL)
+    {
+        ccmd_fmt_flush(formatter);
+        available = formatter->buffer_capacity - 1;
+    }
+    return CPLATFORM_MAX(available, 0);
+}
+
+static int ccmd_fmt_copy(struct ccmd_formatter* formatter, const char* data, const int32_t length)
+{
+    int32_t written = 0;
+    while (written < length)
+    {
+        const int32_t count = CPLATFORM_MIN(length - written, ccmd_fmt_available(formatter, length - written));
+        if (count <= 0)
+        {
+            formatter->overflow = true;
+            break;
+        }
+
+        memcpy(formatter->buffer + formatter->length, data + written, count);
+        formatter->length += count;
+        written += count;
+    }
+
+    if (formatter->buffer_capacity > 0)
+    {
+        formatter->buffer[formatter->length] = '\0';
+    }
+    return written;
+}
+
+static int ccmd_fmt_write(struct ccmd_formatter* formatter, const char* data, const int32_t length)
+{
+    // reference long strings directly - leave one chunk free for whatever gets buffered after this
+    if (formatter->sink != NULL && length >= CCMD_FMT_CHUNK_MIN_LENGTH)
+    {
+        if (formatter->chunk_count + 2 >= formatter->chunk_capacity)
+        {
+            ccmd_fmt_flush(formatter);
+        }
+
+        ccmd_fmt_end_chunk(formatter);
+        formatter->chunks[formatter->chunk_count++] = (ccmd_write_chunk) { data, length };
+        return length;
+    }
+
+    return ccmd_fmt_copy(formatter, data, length);
+}
+
+int ccmd_fmt_vsnprintf(struct ccmd_formatter* formatter, const char* format, va_list args)
+{
+    va_list retry_args;
+    va_copy(retry_args, args);
+
+    int32_t dst_size = formatter->buffer_capacity - formatter->length;
+    int count = dst_size > 0 ? vsnprintf(formatter->buffer + formatter->length, dst_size, format, args) : -1;
+    if (dst_size > 0 && count >= 0 && count <= dst_size - 1)
+    {
+        formatter->length += count;
+        va_end(retry_args);
+        return count;
+    }
+
+    // didn't fit - when streaming flush and try again, formatting into a temporary if it won't fit in the whole buffer
+    if (formatter->sink != NULL && count > 0)
+    {
+        if (count < formatter->buffer_capacity)
+        {
+            ccmd_fmt_flush(formatter);
+            count = vsnprintf(formatter->buffer, formatter->buffer_capacity, format, retry_args);
+            formatter->length = count;
+        }
+        else
+        {
+            char* temp = (char*)CCMD_MALLOC(count + 1);
+            if (temp != NULL)
+            {
+                // copied rather than referenced as it's freed straight away
+                vsnprintf(temp, count + 1, format, retry_args);
+                count = ccmd_fmt_copy(formatter, temp, count);
+                CCMD_FREE(temp);
+            }
+        }
+        va_end(retry_args);
+        return count;
+    }
+
+    // vsnprintf returns the untruncated length - clamp so the formatter never runs off the end of the buffer
+    va_end(retry_args);
+    if (count > 0 && dst_size > 0)
+    {
+        formatter->overflow = true;
+        count = dst_size - 1;
+        formatter->length += count;
+        return count;
+    }
+
+    formatter->overflow |= dst_size <= 0;
+    return 0;
+}
+
+int ccmd_fmt(struct ccmd_formatter* formatter, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const int count = ccmd_fmt_vsnprintf(formatter, format, args);
+    va_end(args);
+    return count;
+}
+
+int ccmd_fmt_putc(struct ccmd_formatter* formatter, const char c)
+{
+    if (ccmd_fmt_available(formatter, 1) < 1)
+    {
+        formatter->overflow = true;
+        return 0;
+    }
+
+    formatter->buffer[formatter->length++] = c;
+    formatter->buffer[formatter->length] = '\0';
+    return 1;
+}
+
+int ccmd_fmt_puts(struct ccmd_formatter* formatter, const char* string)
+{
+    if (string == NULL)
+    {
+        return 0;
+    }
+
+    return ccmd_fmt_write(formatter, string, (int32_t)strlen(string));
+}
+
+int ccmd_fmt_put_option_name(struct ccmd_formatter* formatter, const char short_name, const char* long_name)
+{
+    int count = 0;
+
+    if (short_name != '\0')
+    {
+        count += ccmd_fmt_putc(formatter, '-');
+        count += ccmd_fmt_putc(formatter, short_name);
+    }
+    if (short_name != '\0' && long_name != NULL)
+    {
+        count += ccmd_fmt_putc(formatter, '/');
+    }
+    if (long_name != NULL)
+    {
+        count += ccmd_fmt_puts(formatter, "--");
+        count += ccmd_fmt_puts(formatter, long_name);
+    }
+
+    return count;
+}
+
+int ccmd_fmt_spaces_base(struct ccmd_formatter* formatter, const int column_size, const int label_length)
+{
+    const int required = column_size - label_length;
+    if (required <= 0)
+    {
+        return 0;
+    }
+
+    const int spaces = CPLATFORM_MIN(required, ccmd_fmt_available(formatter, required));
+    formatter->overflow |= spaces < required;
+    if (spaces <= 0)
+    {
+        return 0;
+    }
+
+    memset(formatter->buffer + formatter->length, ' ', spaces);
+    formatter->length += spaces;
+    formatter->buffer[formatter->length] = '\0';
+    return spaces;
+}
+
+int ccmd_fmt_spaces_arg(struct ccmd_formatter* formatter, const int column_size, const char* name)
+{
+    return ccmd_fmt_spaces_base(formatter, column_size, (int)strlen(name));
+}
+
+int ccmd_fmt_spaces_opt(struct ccmd_formatter* formatter, const int column_size, const ccmd_option* option)
+{
+    return ccmd_fmt_spaces_base(formatter, column_size, ccmd_option_display_length(option));
+}
+
+static int ccmd_qsort_error_comp(const void* lhs, const void* rhs)
+{
+    const ccmd_error* lhs_error = (const ccmd_error*)lhs;
+    const ccmd_error* rhs_error = (const ccmd_error*)rhs;
+    return (int)CCMD_ERROR_KEY_CATEGORY(lhs_error->key) - (int)CCMD_ERROR_KEY_CATEGORY(rhs_error->key);
+}
+
+int ccmd_default_error_report(const char* program_name, ccmd_formatter* formatter, ccmd_result* result)
+{
+    static const char* fmt_token_name[CCMD_ARGUMENT_INVALID + 1] = {
+        "option",       // CCMD_ARGUMENT_OPTION
+        "option",       // CCMD_ARGUMENT_OPTION_N_OR_MORE
+        "positional",   // CCMD_ARGUMENT_POSITIONAL
+        "subcommand",   // CCMD_ARGUMENT_SUBCOMMAND
+        "applet",       // CCMD_ARGUMENT_APPLET
+        "<#INVALID>",   // CCMD_ARGUMENT_INVALID
+    };
+
+    // sort into error categories
+    qsort(result->errors.data, result->error_count, sizeof(const ccmd_error), ccmd_qsort_error_comp);
+
+    const int old_formatter_length = ccmd_fmt_total(formatter);
+    int category_progress[CCMD_ERROR_CATEGORY_COUNT][2] = { { 0, 0 } };
+    for (int i = 0; i < result->error_count; ++i)
+    {
+        ++category_progress[CCMD_ERROR_KEY_CATEGORY(result->errors.data[i].key)][1];
+    }
+
+    for (int i = 0; i < result->error_count; ++i)
+    {
+        const ccmd_error* error = &result->errors.data[i];
+        const ccmd_error_category category = CCMD_ERROR_KEY_CATEGORY(error->key);
+        const ccmd_argument_type arg_type = CCMD_ERROR_KEY_ARG_TYPE(error->key);
+        const int index_in_category = category_progress[category][0];
+        const int last_index_in_category = category_progress[category][1] - 1;
+
+        category_progress[category][0]++;
+
+        switch (category)
+        {
+            case CCMD_ERROR_CATEGORY_MISSING_REQUIRED_ARGUMENT:
+            {
+                if (index_in_category == 0)
+                {
+                    ccmd_fmt(formatter, "%s: error: the following arguments are required: ", program_name);
+                }
+
+                if (arg_type == CCMD_TOKEN_SHORT_OPTION || arg_type == CCMD_TOKEN_LONG_OPTION)
+                {
+                    ccmd_fmt_put_option_name(formatter, error->char8, error->str);
+                }
+                else
+                {
+                    ccmd_fmt_puts(formatter, error->str);
+                }
+
+                ccmd_fmt_puts(formatter, index_in_category < last_index_in_category ? ", " : "\n");
+                break;
+            }
+            case CCMD_ERROR_CATEGORY_INVALID_NARGS:
+            {
+                ccmd_fmt(formatter, "%s: error: option ", program_name);
+                ccmd_fmt_put_option_name(formatter, error->char8, error->str);
+
+                if (arg_type == CCMD_ARGUMENT_OPTION_N_OR_MORE)
+                {
+                    ccmd_fmt(formatter, " expected at least %d argument", error->int32);
+                }
+                else
+                {
+                    ccmd_fmt(formatter, " expected %d argument", error->int32);
+                }
+
+                if (error->int32 != 1)
+                {
+                    ccmd_fmt_putc(formatter, 's'); // plural nargs
+                }
+
+                ccmd_fmt_putc(formatter, '\n');
+                break;
+            }
+            case CCMD_ERROR_CATEGORY_UNRECOGNIZED_ARGUMENT:
+            {
+                ccmd_fmt(formatter, "%s: error; unrecognized %s: %.*s", program_name, fmt_token_name[arg_type], error->int32, error->str);
+                if (error->suggestion != NULL)
+                {
+                    ccmd_fmt(formatter, " (did you mean %s%s?)", arg_type == CCMD_ARGUMENT_SUBCOMMAND ? "" : "--", error->suggestion);
+                }
+                ccmd_fmt_putc(formatter, '\n');
+                break;
+            }
+            case CCMD_ERROR_CATEGORY_INTERNAL:
+            {
+                ccmd_fmt(formatter, "%s: error: internal error - %s\n", program_name, error->str);
+                break;
+            }
+            case CCMD_ERROR_CATEGORY_RESPONSE_FILE:
+            {
+                static const char* fmt_response_file_error[CCMD_RESPONSE_FILE_ERROR_COUNT] = {
+                    "includes itself",                  // CCMD_RESPONSE_FILE_ERROR_CYCLE
+                    "is nested too deeply",             // CCMD_RESPONSE_FILE_ERROR_DEPTH
+                    "could not be loaded into memory",  // CCMD_RESPONSE_FILE_ERROR_ALLOCATION
+                };
+                ccmd_fmt(formatter, "%s: error: response file %s %s\n", program_name, error->str, fmt_response_file_error[error->int32]);
+                break;
+            }
+            case CCMD_ERROR_CATEGORY_INVALID_VALUE:
+            {
+                static const char* fmt_value_type[CCMD_VALUE_COUNT] = {
+                    "a string",                         // CCMD_VALUE_STRING
+                    "an integer",                       // CCMD_VALUE_INT64
+                    "a number",                         // CCMD_VALUE_DOUBLE
+                    "true or false",                    // CCMD_VALUE_BOOL
+                    "a size",                           // CCMD_VALUE_SIZE
+                    "a duration",                       // CCMD_VALUE_DURATION
+                };
+                ccmd_fmt(formatter, "%s: error: option ", program_name);
+                ccmd_fmt_put_option_name(formatter, error->char8, error->str);
+                ccmd_fmt(formatter, " expected %s but got '%s'\n", fmt_value_type[error->int32], error->value);
+                break;
+            }
+            case CCMD_ERROR_CATEGORY_INVALID_CHOICE:
+            {
+                ccmd_fmt(formatter, "%s: error: option ", program_name);
+                ccmd_fmt_put_option_name(formatter, error->char8, error->str);
+                ccmd_fmt(formatter, " got invalid choice '%s'", error->value);
+
+                const ccmd_command* command = error->command;
+                if (command != NULL && error->int32 < command->options.count)
+                {
+                    const ccmd_option* option = &command->options.data[error->int32];
+                    for (int c = 0; c < option->choices.count; ++c)
+                    {
+                        ccmd_fmt(formatter, c == 0 ? " (choose from '%s'" : ", '%s'", option->choices.data[c]);
+                    }
+                    ccmd_fmt_puts(formatter, option->choices.count > 0 ? ")" : "");
+                }
+
+                ccmd_fmt_putc(formatter, '\n');
+                break;
+            }
+            case CCMD_ERROR_CATEGORY_AMBIGUOUS_ARGUMENT:
+            {
+                const bool is_option = arg_type != CCMD_ARGUMENT_SUBCOMMAND;
+                const char* dashes = is_option ? "--" : "";
+                ccmd_fmt(formatter, "%s: error: ambiguous %s: %s%.*s could match", program_name, fmt_token_name[arg_type], dashes, error->int32, error->str);
+
+                // list every name the abbreviation is a prefix of in declaration order
+                const ccmd_command* command = error->command;
+                const int32_t name_count = command == NULL ? 0 : (is_option ? command->options.count : command->subcommands.count);
+                bool first = true;
+                for (int32_t n = 0; n < name_count; ++n)
+                {
+                    const char* name = is_option ? command->options.data[n].long_name : command->subcommands.data[n].name;
+                    if (name != NULL && strncmp(name, error->str, error->int32) == 0)
+                    {
+                        ccmd_fmt(formatter, "%s%s%s", first ? " " : ", ", dashes, name);
+                        first = false;
+                    }
+                }
+
+                ccmd_fmt_putc(formatter, '\n');
+                break;
+            }
+            case CCMD_ERROR_CATEGORY_INVALID_QUOTING:
+            {
+                if (error->char8 == '\\')
+                {
+                    ccmd_fmt(formatter, "%s: error: no character after escape at the end of the line\n", program_name);
+                }
+                else
+                {
+                    ccmd_fmt(formatter, "%s: error: unterminated %c quote\n", program_name, error->char8);
+                }
+                break;
+            }
+            default:
+            {
+                ccmd_fmt(formatter, "%s: error: internal error - invalid error type: %d\n", program_name, arg_type);
+                break;
+            }
+        }
+    }
+
+    return ccmd_fmt_total(formatter) - old_formatter_length;
+}
+
+/*
+ *****************************
+ *
+ * Generate a usage message
+ * from the command spec
+ *
+ *****************************
+ */
+// Width of the label column for a command's help sections - the longest option, positional or subcommand name plus
+// at least 4 spaces before the help string
+static int32_t ccmd_help_column(const ccmd_command* command)
+{
+    int32_t help_spacing = 10; // -h, --help
+    for (int i = 0; i < command->options.count; ++i)
+    {
+        help_spacing = CPLATFORM_MAX(help_spacing, ccmd_option_display_length(&command->options.data[i]));
+    }
+    for (int i = 0; i < command->positionals.count; ++i)
+    {
+        help_spacing = CPLATFORM_MAX(help_spacing, (int32_t)strlen(command->positionals.data[i].name));
+    }
+    for (int i = 0; i < command->subcommands.count; ++i)
+    {
+        help_spacing = CPLATFORM_MAX(help_spacing, (int32_t)strlen(command->subcommands.data[i].name));
+    }
+    return CPLATFORM_MAX(CCMD_HELP_MIN_COLS, help_spacing + 4);
+}
+
+// Writes `text` from `column` onwards, breaking lines between words so none go past `width` columns. Continuation
+// lines are indented to `indent` and newlines already in the text are kept. Words are only looked at once so this is
+// a single pass over the string
+static void ccmd_fmt_wrapped(ccmd_formatter* formatter, const char* text, const int32_t indent, int32_t column, int32_t width)
+{
+    if (text == NULL)
+    {
+        return;
+    }
+
+    if (width <= 0)
+    {
+        ccmd_fmt_write(formatter, text, (int32_t)strlen(text));
+        return;
+    }
+
+    // a really narrow terminal would leave a word or two per line - overrun it a little instead
+    width = CPLATFORM_MAX(width, indent + CCMD_HELP_MIN_WRAP);
+
+    bool line_start = true;
+    const char* cursor = text;
+    while (*cursor != '\0')
+    {
+        if (*cursor == ' ')
+        {
+            ++cursor;
+            continue;
+        }
+
+        if (*cursor == '\n')
+        {
+            ccmd_fmt_putc(formatter, '\n');
+            ccmd_fmt_spaces_base(formatter, indent, 0);
+            column = indent;
+            line_start = true;
+            ++cursor;
+            continue;
+        }
+
+        const char* word = cursor;
+        while (*cursor != '\0' && *cursor != ' ' && *cursor != '\n')
+        {
+            ++cursor;
+        }
+        const int32_t word_length = (int32_t)(cursor - word);
+
+        if (!line_start)
+        {
+            if (column + 1 + word_length > width)
+            {
+                ccmd_fmt_putc(formatter, '\n');
+                ccmd_fmt_spaces_base(formatter, indent, 0);
+                column = indent;
+            }
+            else
+            {
+                ccmd_fmt_putc(formatter, ' ');
+                ++column;
+            }
+        }
+
+        ccmd_fmt_write(formatter, word, word_length);
+        column += word_length;
+        line_start = false;
+    }
+}
+
+// `help_column` is the precomputed ccmd_help_column of the executed command or 0 to work it out here. Help strings
+// are wrapped to `width` columns unless it's 0
+void ccmd_generate_usage(ccmd_formatter* usage_formatter, const int32_t command_count, const ccmd_command* const* commands, int32_t help_column, const int32_t width)
+{
+    ccmd_fmt(usage_formatter, "usage: ");
+
+    const ccmd_command* executed_command = commands[command_count - 1];
+
+    for (int i = 0; i < command_count; ++i)
+    {
+        const ccmd_command* command = commands[i];
+
+        if (command->name != NULL)
+        {
+            ccmd_fmt(usage_formatter, "%s ", command->name);
+        }
+
+        if (command->options.count > 0)
+        {
+            // Print out all the required options
+            for (int opt_idx = 0; opt_idx < command->options.count; ++opt_idx)
+            {
+                if (command->options.data[opt_idx].required)
+                {
+                    const char* long_name = command->options.data[opt_idx].long_name;
+                    const int nargs = command->options.data[opt_idx].nargs;
+                    ccmd_fmt(usage_formatter, "--%s %s", long_name, nargs != 0 ? "ARGS " : "");
+                }
+            }
+
+            ccmd_fmt(usage_formatter, "[options...] ");
+        }
+
+        if (command->positionals.count > 0)
+        {
+            for (int pos_idx = 0; pos_idx < command->positionals.count; ++pos_idx)
+            {
+                // print out positionals with specific amount of spacing, i.e
+                // `program positional1 positional2 ...`
+                ccmd_fmt(usage_formatter, "%s ", command->positionals.data[pos_idx].name);
+            }
+        }
+
+        if (command == executed_command && command->subcommands.count > 0)
+        {
+            ccmd_fmt(usage_formatter, "<command> ");
+        }
+    }
+
+    if (executed_command->help != NULL)
+    {
+        ccmd_fmt(usage_formatter, "\n\n");
+        ccmd_fmt_wrapped(usage_formatter, executed_command->help, 0, 0, width);
+    }
+
+    // help strings start after the 2 space indent and the label column
+    const int32_t help_spacing = help_column > 0 ? help_column : ccmd_help_column(executed_command);
+    const int32_t help_indent = 2 + help_spacing;
+
+    // output the positional args
+    if (executed_command->positionals.count > 0)
+    {
+        ccmd_fmt(usage_formatter, "\n\nArguments:\n");
+
+        // print out positionals with specific amount of spacing, i.e `positional1  help string`
+        for (int pos_idx = 0; pos_idx < executed_command->positionals.count; ++pos_idx)
+        {
+            ccmd_fmt(usage_formatter, "  %s", executed_command->positionals.data[pos_idx].name);
+            ccmd_fmt_spaces_arg(usage_formatter, help_spacing, executed_command->positionals.data[pos_idx].name);
+            ccmd_fmt_wrapped(usage_formatter, executed_command->positionals.data[pos_idx].help, help_indent, help_indent, width);
+            ccmd_fmt_putc(usage_formatter, '\n');
+        }
+    }
+
+    ccmd_fmt(usage_formatter, "\nOptions:\n  -h, --help");
+    ccmd_fmt_spaces_arg(usage_formatter, help_spacing, "-h, --help");
+    ccmd_fmt_wrapped(usage_formatter, "Returns this help message", help_indent, help_indent, width);
+    ccmd_fmt_putc(usage_formatter, '\n');
+
+    if (executed_command->options.count > 0)
+    {
+        // print out options, i.e `-o, --option1  help string`
+        for (int opt_idx = 0; opt_idx < executed_command->options.count; ++opt_idx)
+        {
+            const ccmd_option* option = &executed_command->options.data[opt_idx];
+            ccmd_fmt(usage_formatter, "  ");
+
+            // Write out short name
+            if (option->short_name != '\0')
+            {
+                ccmd_fmt(usage_formatter, "-%c, ", option->short_name);
+            }
+
+            // Write long name
+            ccmd_fmt(usage_formatter, "--%s", option->long_name);
+            ccmd_fmt_spaces_opt(usage_formatter, help_spacing, option);
+            // Write help string
+            ccmd_fmt_wrapped(usage_formatter, option->help, help_indent, help_indent, width);
+            ccmd_fmt_putc(usage_formatter, '\n');
+        }
+    }
+
+    // generate just a list of names for subcommands
+    if (executed_command->subcommands.count > 0)
+    {
+        ccmd_fmt(usage_formatter, "\nCommands:\n  ");
+
+        for (int cmd_idx = 0; cmd_idx < executed_command->subcommands.count; ++cmd_idx)
+        {
+            ccmd_fmt(usage_formatter, "%s", executed_command->subcommands.data[cmd_idx].name);
+
+            if (cmd_idx < executed_command->subcommands.count - 1)
+            {
+                ccmd_fmt(usage_formatter, ", ");
+            }
+        }
+    }
+}
+
+
+/*
+ *****************************
+ *
+ * Argument classification
+ *
+ *****************************
+ */
+static uint8_t ccmd_count_leading_dashes(const char* arg)
+{
+    uint8_t dashes = 0;
+    while (dashes < 3 && arg[dashes] == '-')
+    {
+        ++dashes;
+    }
+    return dashes;
+}
+
+static void ccmd_scan_args_scalar(const int32_t argc, char* const* argv, ccmd_arg_info* infos)
+{
+    for (int i = 0; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        ccmd_arg_info* info = &infos[i];
+        info->equals = -1;
+        info->length = 0;
+        info->dashes = 0;
+
+        if (arg == NULL)
+        {
+            continue;
+        }
+
+        for (; arg[info->length] != '\0'; ++info->length)
+        {
+            if (arg[info->length] == '=' && info->equals < 0)
+            {
+                info->equals = info->length;
+            }
+        }
+
+        info->dashes = ccmd_count_leading_dashes(arg);
+    }
+}
+
+static int ccmd_ctz(const uint32_t value)
+{
+#if CPLATFORM_COMPILER_MSVC == 1
+    unsigned long index = 0;
+    _BitScanForward(&index, value);
+    return (int)index;
+#else
+    return __builtin_ctz(value);
+#endif // CPLATFORM_COMPILER_MSVC == 1
+}
+
+#if CCMD_SIMD_X86 == 1
+
+// Both vector scans only ever do aligned loads so they can't cross into an unmapped page past the end of an argument.
+// The bits for bytes before the start of the argument in the first block are shifted out of the masks
+CCMD_NO_SANITIZE_ADDRESS
+static void ccmd_scan_args_sse2(const int32_t argc, char* const* argv, ccmd_arg_info* infos)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i equals = _mm_set1_epi8('=');
+
+    for (int i = 0; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        ccmd_arg_info* info = &infos[i];
+        info->equals = -1;
+        info->length = 0;
+        info->dashes = 0;
+
+        if (arg == NULL)
+        {
+            continue;
+        }
+
+        const int misalignment = (int)((uintptr_t)arg & 15);
+        const char* block = arg - misalignment;
+        int32_t block_offset = -misalignment; // offset of `block` relative to `arg`
+        __m128i chunk = _mm_load_si128((const __m128i*)block);
+        uint32_t zero_mask = ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero)) >> misalignment) << misalignment;
+        uint32_t equals_mask = ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, equals)) >> misalignment) << misalignment;
+
+        while (zero_mask == 0)
+        {
+            if (info->equals < 0 && equals_mask != 0)
+            {
+                info->equals = block_offset + ccmd_ctz(equals_mask);
+            }
+
+            block += 16;
+            block_offset += 16;
+            chunk = _mm_load_si128((const __m128i*)block);
+            zero_mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero));
+            equals_mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, equals));
+        }
+
+        const int terminator = ccmd_ctz(zero_mask);
+        info->length = block_offset + terminator;
+
+        // only count an '=' in the last block if it's before the terminator
+        equals_mask &= (1u << terminator) - 1;
+        if (info->equals < 0 && equals_mask != 0)
+        {
+            info->equals = block_offset + ccmd_ctz(equals_mask);
+        }
+
+        info->dashes = ccmd_count_leading_dashes(arg);
+    }
+}
+
+#if CPLATFORM_COMPILER_GCC == 1 || CPLATFORM_COMPILER_CLANG == 1
+    #define CCMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define CCMD_TARGET_AVX2
+#endif // CPLATFORM_COMPILER_GCC == 1 || CPLATFORM_COMPILER_CLANG == 1
+
+CCMD_NO_SANITIZE_ADDRESS CCMD_TARGET_AVX2
+static void ccmd_scan_args_avx2(const int32_t argc, char* const* argv, ccmd_arg_info* infos)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i equals = _mm256_set1_epi8('=');
+
+    for (int i = 0; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        ccmd_arg_info* info = &infos[i];
+        info->equals = -1;
+        info->length = 0;
+        info->dashes = 0;
+
+        if (arg == NULL)
+        {
+            continue;
+        }
+
+        const int misalignment = (int)((uintptr_t)arg & 31);
+        const char* block = arg - misalignment;
+        int32_t block_offset = -misalignment;
+        __m256i chunk = _mm256_load_si256((const __m256i*)block);
+        uint32_t zero_mask = ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, zero)) >> misalignment) << misalignment;
+        uint32_t equals_mask = ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, equals)) >> misalignment) << misalignment;
+
+        while (zero_mask == 0)
+        {
+            if (info->equals < 0 && equals_mask != 0)
+            {
+                info->equals = block_offset + ccmd_ctz(equals_mask);
+            }
+
+            block += 32;
+            block_offset += 32;
+            chunk = _mm256_load_si256((const __m256i*)block);
+            zero_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, zero));
+            equals_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, equals));
+        }
+
+        const int terminator = ccmd_ctz(zero_mask);
+        info->length = block_offset + terminator;
+
+        // terminator can be 31 here so build the mask in 64 bits
+        equals_mask &= (uint32_t)((1ull << terminator) - 1);
+        if (info->equals < 0 && equals_mask != 0)
+        {
+            info->equals = block_offset + ccmd_ctz(equals_mask);
+        }
+
+        info->dashes = ccmd_count_leading_dashes(arg);
+    }
+}
+
+static bool ccmd_cpu_has_avx2(void)
+{
+#if CPLATFORM_COMPILER_MSVC == 1
+    int registers[4] = { 0 };
+    __cpuid(registers, 0);
+    if (registers[0] < 7)
+    {
+        return false;
+    }
+
+    // the OS also has to save the YMM registers on context switches
+    __cpuid(registers, 1);
+    const bool osxsave = (registers[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    __cpuidex(registers, 7, 0);
+    return (registers[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif // CPLATFORM_COMPILER_MSVC == 1
+}
+
+#endif // CCMD_SIMD_X86 == 1
+
+// Resolved on each call rather than cached in a global so parsing never touches shared mutable state
+static ccmd_scan_args_function ccmd_select_scan_args(void)
+{
+#if CCMD_SIMD_X86 == 1
+    return ccmd_cpu_has_avx2() ? ccmd_scan_args_avx2 : ccmd_scan_args_sse2;
+#else
+    return ccmd_scan_args_scalar;
+#endif // CCMD_SIMD_X86 == 1
+}
+
+/*
+ *****************************
+ *
+ * Subcommand/root command
+ * parsing API
+ *
+ *****************************
+ */
+// Token type for every shape of argument the classification pre-pass can find, indexed by the number of leading
+// dashes and what follows them: nothing, a name or an '='. Arguments are never stepped through again to tokenize them
+#define CCMD_ARG_SHAPE_NOTHING  0
+#define CCMD_ARG_SHAPE_NAME     1
+#define CCMD_ARG_SHAPE_EQUALS   2
+
+static const uint8_t ccmd_token_types[4][3] = {
+    //  nothing                     name                        '='
+    {   CCMD_TOKEN_POSITIONAL,      CCMD_TOKEN_POSITIONAL,      CCMD_TOKEN_POSITIONAL },    // '' and "" quote empty arguments
+    {   CCMD_TOKEN_POSITIONAL,      CCMD_TOKEN_SHORT_OPTION,    CCMD_TOKEN_SHORT_OPTION },  // a lone '-' is conventionally stdin
+    {   CCMD_TOKEN_DELIMITER,       CCMD_TOKEN_LONG_OPTION,     CCMD_TOKEN_POSITIONAL },    // '--=x' has no name
+    {   CCMD_TOKEN_POSITIONAL,      CCMD_TOKEN_POSITIONAL,      CCMD_TOKEN_POSITIONAL },    // '---x' isn't an option
+};
+
+// Splits a single argument into a token without writing to it. Option names and values are slices into the argument
+// so `--name=value` and `-ovalue` don't need to be split up by the caller
+static ccmd_token ccmd_tokenize(char* arg, const ccmd_arg_info* info)
+{
+    ccmd_token token = { CCMD_TOKEN_INVALID, arg, info->length, NULL, 0 };
+    if (arg == NULL)
+    {
+        return token;
+    }
+
+    const int shape = info->length == info->dashes
+        ? CCMD_ARG_SHAPE_NOTHING
+        : (info->equals == info->dashes ? CCMD_ARG_SHAPE_EQUALS : CCMD_ARG_SHAPE_NAME);
+    token.type = (ccmd_token_type)ccmd_token_types[info->dashes][shape];
+
+    switch (token.type)
+    {
+        case CCMD_TOKEN_SHORT_OPTION:
+        {
+            // everything after the first letter is either more flags or the option's value - the parser decides
+            token.value = arg + 1;
+            token.length = 1;
+            token.attached = info->length > 2 ? arg + 2 : NULL;
+            token.attached_length = info->length - 2;
+            break;
+        }
+        case CCMD_TOKEN_LONG_OPTION:
+        {
+            // '--name=' attaches an empty value rather than none at all
+            token.value = arg + 2;
+            token.length = (info->equals < 0 ? info->length : info->equals) - 2;
+            token.attached = info->equals < 0 ? NULL : arg + info->equals + 1;
+            token.attached_length = info->equals < 0 ? 0 : info->length - info->equals - 1;
+            break;
+        }
+        case CCMD_TOKEN_DELIMITER:
+        {
+            // A solitary '--' argument indicates the command line should stop parsing
+            token.value = arg + 2;
+            token.length = 0;
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    return token;
+}
+
+// Moves a short option token on to the next letter of its cluster. False once there are no letters left
+static bool ccmd_next_cluster_option(ccmd_token* token)
+{
+    if (token->type != CCMD_TOKEN_SHORT_OPTION || token->attached == NULL)
+    {
+        return false;
+    }
+
+    token->value = token->attached;
+    token->attached = token->attached_length > 1 ? token->attached + 1 : NULL;
+    --token->attached_length;
+    return true;
+}
+
+ccmd_token ccmd_parse_element(const ccmd_parser* parser, char* arg, const ccmd_arg_info* info)
+{
+    ccmd_token token = ccmd_tokenize(arg, info);
+    if (token.type != CCMD_TOKEN_POSITIONAL)
+    {
+        return token;
+    }
+
+    const ccmd_command_result* command_result = parser->command_result;
+    const ccmd_command* command_info = parser->command_infos[parser->program_result->commands_count - 1];
+    const ccmd_command_result* subcommand = &parser->program_result->commands.data[parser->program_result->commands_count - 1];
+    const bool all_positionals_parsed = command_result->positionals.count >= command_info->positionals.count;
+    const bool has_parsed_subcommands = subcommand > parser->command_result;
+
+    token.type = (all_positionals_parsed && !has_parsed_subcommands) ? CCMD_TOKEN_SUBCOMMAND : CCMD_TOKEN_POSITIONAL;
+    return token;
+}
+
+// Exactly -h or --help. Abbreviations of --help only count once they're known not to name one of the command's options
+static bool ccmd_is_help_option(const ccmd_token* element)
+{
+    if (element->type == CCMD_TOKEN_SHORT_OPTION)
+    {
+        return element->value[0] == 'h';
+    }
+
+    return element->type == CCMD_TOKEN_LONG_OPTION && element->length == 4 && memcmp(element->value, "help", 4) == 0;
+}
+
+uint32_t ccmd_hash_string(const char* string, const int32_t length)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; ++i)
+    {
+        hash ^= (uint8_t)string[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+int ccmd_hash_table_find(const ccmd_hash_table* table, const char* key, const int32_t length)
+{
+    if (table->slots == NULL)
+    {
+        return -1;
+    }
+
+    const uint32_t hash = ccmd_hash_string(key, length);
+    for (uint32_t i = hash & table->mask;; i = (i + 1) & table->mask)
+    {
+        const ccmd_hash_slot* slot = &table->slots[i];
+        if (slot->name == NULL)
+        {
+            return -1;
+        }
+
+        if (slot->hash == hash && strncmp(slot->name, key, length) == 0 && slot->name[length] == '\0')
+        {
+            return slot->index;
+        }
+    }
+}
+
+uint64_t ccmd_hash_string64(const char* string, const int32_t length)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (int i = 0; i < length; ++i)
+    {
+        hash ^= (uint8_t)string[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t ccmd_hash_displace(const uint64_t hash, const uint32_t seed)
+{
+    // murmur3 finalizer
+    uint64_t x = hash ^ ((uint64_t)seed * 0x9E3779B97F4A7C15ull);
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    return x;
+}
+
+int ccmd_option_table_find_long(const ccmd_option_table* table, const char* name, const int32_t length)
+{
+    if (table->slots == NULL)
+    {
+        return -1;
+    }
+
+    const uint64_t hash = ccmd_hash_string64(name, length);
+    const uint32_t seed = table->seeds[hash & table->bucket_mask];
+    const ccmd_option_slot* slot = &table->slots[ccmd_hash_displace(hash, seed) & table->slot_mask];
+
+    // every name has exactly one possible slot so a single compare decides the lookup
+    if (slot->name != NULL && slot->length == length && memcmp(slot->name, name, length) == 0)
+    {
+        return slot->index;
+    }
+
+    return -1;
+}
+
+// Name member of the `index`th struct in an array that starts at `names` and is `stride` bytes per element
+static const char* ccmd_strided_name(const char* const* names, const size_t stride, const int32_t index)
+{
+    return *(const char* const*)((const char*)names + stride * index);
+}
+
+// Query side of the edit distance kernel - one bit per character position for every byte value
+typedef struct ccmd_edit_pattern
+{
+    uint64_t    peq[256];
+    int32_t     length;
+} ccmd_edit_pattern;
+
+// Returns false if `text` is too long for the bit-parallel kernel
+static bool ccmd_edit_pattern_init(ccmd_edit_pattern* pattern, const char* text, const int32_t length)
+{
+    if (length <= 0 || length > 64)
+    {
+        return false;
+    }
+
+    memset(pattern->peq, 0, sizeof(pattern->peq));
+    for (int32_t i = 0; i < length; ++i)
+    {
+        pattern->peq[(uint8_t)text[i]] |= UINT64_C(1) << i;
+    }
+    pattern->length = length;
+    return true;
+}
+
+// Levenshtein distance between `length` characters of the pattern starting at `offset` and `text` using Myers'
+// bit-parallel algorithm - one column of the DP matrix per character of `text`. Stops as soon as the distance can't
+// come back down to `bound` and returns `bound + 1` in that case
+static int32_t ccmd_edit_distance(const ccmd_edit_pattern* pattern, const int32_t offset, const int32_t length, const char* text, const int32_t text_length, const int32_t bound)
+{
+    if (length <= 0)
+    {
+        return CPLATFORM_MIN(text_length, bound + 1);
+    }
+
+    // bits above `length` never carry down into the ones that are looked at so they don't need masking
+    const uint64_t high_bit = UINT64_C(1) << (length - 1);
+    uint64_t positive_vertical = ~UINT64_C(0);
+    uint64_t negative_vertical = 0;
+    int32_t score = length;
+
+    for (int32_t i = 0; i < text_length; ++i)
+    {
+        const uint64_t equal = pattern->peq[(uint8_t)text[i]] >> offset;
+        const uint64_t vertical = equal | negative_vertical;
+        const uint64_t horizontal = (((equal & positive_vertical) + positive_vertical) ^ positive_vertical) | equal;
+        uint64_t positive_horizontal = negative_vertical | ~(horizontal | positive_vertical);
+        uint64_t negative_horizontal = positive_vertical & horizontal;
+
+        score += (positive_horizontal & high_bit) != 0 ? 1 : 0;
+        score -= (negative_horizontal & high_bit) != 0 ? 1 : 0;
+
+        // each remaining character can lower the score by at most one
+        if (score - (text_length - i - 1) > bound)
+        {
+            return bound + 1;
+        }
+
+        // the top row of the matrix goes up by one per character
+        positive_horizontal = (positive_horizontal << 1) | 1;
+        negative_horizontal <<= 1;
+        positive_vertical = negative_horizontal | ~(vertical | positive_horizontal);
+        negative_vertical = positive_horizontal & vertical;
+    }
+
+    return score <= bound ? score : bound + 1;
+}
+
+// Closest of `names` to an unrecognized name or NULL if none are within CCMD_SUGGEST_DISTANCE_MAX edits. If
+// `sorted_by_length` is set only names that are close enough in length are looked at, otherwise `names` is the name
+// member of the first struct in an array `stride` bytes apart and every name is checked
+static const char* ccmd_suggest_name(const ccmd_sorted_name* sorted_by_length, const char* const* names, const size_t stride, const int32_t count, const char* name, const int32_t length)
+{
+    ccmd_edit_pattern pattern;
+    if (count <= 0 || !ccmd_edit_pattern_init(&pattern, name, length))
+    {
+        return NULL;
+    }
+
+    // short names get fewer edits or anything would be a suggestion for them
+    int32_t bound = CPLATFORM_MIN(CCMD_SUGGEST_DISTANCE_MAX, length / 3 + 1);
+    int32_t best_distance = bound + 1;
+    int32_t best_index = INT32_MAX;
+    const char* suggestion = NULL;
+
+    int32_t begin = 0;
+    if (sorted_by_length != NULL)
+    {
+        // first name that's at most `bound` characters shorter
+        int32_t end = count;
+        while (begin < end)
+        {
+            const int32_t middle = begin + (end - begin) / 2;
+            if (sorted_by_length[middle].length < length - bound)
+            {
+                begin = middle + 1;
+            }
+            else
+            {
+                end = middle;
+            }
+        }
+    }
+
+    for (int32_t i = begin; i < count; ++i)
+    {
+        const char* candidate = sorted_by_length != NULL ? sorted_by_length[i].name : ccmd_strided_name(names, stride, i);
+        if (candidate == NULL)
+        {
+            continue;
+        }
+
+        const int32_t candidate_length = sorted_by_length != NULL ? sorted_by_length[i].length : (int32_t)strlen(candidate);
+        if (candidate_length > length + bound)
+        {
+            if (sorted_by_length != NULL)
+            {
+                break;
+            }
+            continue;
+        }
+
+        if (candidate_length < length - bound)
+        {
+            continue;
+        }
+
+        // the closest name wins with ties going to whichever was declared first
+        const int32_t index = sorted_by_length != NULL ? sorted_by_length[i].index : i;
+        // a shared prefix and suffix never change the distance so only the middle goes through the kernel
+        int32_t prefix = 0;
+        while (prefix < length && prefix < candidate_length && name[prefix] == candidate[prefix])
+        {
+            ++prefix;
+        }
+
+        int32_t suffix = 0;
+        while (suffix < length - prefix && suffix < candidate_length - prefix && name[length - 1 - suffix] == candidate[candidate_length - 1 - suffix])
+        {
+            ++suffix;
+        }
+
+        const int32_t distance = ccmd_edit_distance(&pattern, prefix, length - prefix - suffix, candidate + prefix, candidate_length - prefix - suffix, bound);
+        if (distance <= bound && (distance < best_distance || index < best_index))
+        {
+            suggestion = candidate;
+            best_distance = distance;
+            best_index = index;
+            bound = distance;
+        }
+    }
+
+    return suggestion;
+}
+
+// Resolves `name` to the name it's an exact match for or else the only name it's a prefix of. Visits one node per
+// branch in the trie so it's linear in the length of `name`
+static int32_t ccmd_trie_find(const ccmd_trie* trie, const char* name, const int32_t length)
+{
+    if (trie->count <= 0)
+    {
+        return CCMD_NAME_NOT_FOUND;
+    }
+
+    const ccmd_trie_node* node = &trie->nodes[0];
+    int32_t position = 0;
+    for (;;)
+    {
+        const int32_t compare_length = CPLATFORM_MIN(node->label_length, length - position);
+        if (memcmp(node->label, name + position, compare_length) != 0)
+        {
+            return CCMD_NAME_NOT_FOUND;
+        }
+
+        position += compare_length;
+        if (position == length)
+        {
+            // exact matches win over longer names they're a prefix of
+            if (compare_length == node->label_length && node->index >= 0)
+            {
+                return node->index;
+            }
+            return node->unique >= 0 ? node->unique : CCMD_NAME_AMBIGUOUS;
+        }
+
+        const ccmd_trie_node* next = NULL;
+        for (int32_t i = 0; i < node->child_count && next == NULL; ++i)
+        {
+            const ccmd_trie_node* child = &trie->nodes[node->first_child + i];
+            next = child->label[0] == name[position] ? child : NULL;
+        }
+
+        if (next == NULL)
+        {
+            return CCMD_NAME_NOT_FOUND;
+        }
+        node = next;
+    }
+}
+
+// Linear version of ccmd_trie_find for specs that haven't been compiled. `names` points at the name member of the
+// first struct in an array so the same search works for options and subcommands
+static int32_t ccmd_find_abbreviation(const char* const* names, const size_t stride, const int32_t count, const char* name, const int32_t length)
+{
+    int32_t found = CCMD_NAME_NOT_FOUND;
+    for (int32_t i = 0; i < count; ++i)
+    {
+        const char* candidate = ccmd_strided_name(names, stride, i);
+        if (candidate == NULL || strncmp(candidate, name, length) != 0)
+        {
+            continue;
+        }
+
+        if (candidate[length] == '\0')
+        {
+            return i;
+        }
+
+        // duplicate declarations of the same name aren't ambiguous - the first one wins
+        if (found == CCMD_NAME_NOT_FOUND)
+        {
+            found = i;
+        }
+        else if (found >= 0 && strcmp(ccmd_strided_name(names, stride, found), candidate) != 0)
+        {
+            found = CCMD_NAME_AMBIGUOUS;
+        }
+    }
+    return found;
+}
+
+// Returns the index of the option `element` names, CCMD_NAME_NOT_FOUND or CCMD_NAME_AMBIGUOUS if it's an
+// abbreviation of more than one long name
+int ccmd_find_option(ccmd_result* result, const ccmd_command* command, const ccmd_compiled_node* node, const ccmd_token* element)
+{
+    // use the precomputed tables if there are any - either from a compiled spec or assigned directly to the command
+    const ccmd_option_table* table = node != NULL ? node->options : command->option_table;
+
+    if (element->type == CCMD_TOKEN_SHORT_OPTION)
+    {
+        CCMD_INSTRUMENT_ADD(result, option_comparisons, 1);
+        if (table != NULL)
+        {
+            return table->short_options[(uint8_t)element->value[0]];
+        }
+
+        for (int i = 0; i < command->options.count; ++i)
+        {
+            if (command->options.data[i].short_name == element->value[0])
+            {
+                return i;
+            }
+        }
+        return CCMD_NAME_NOT_FOUND;
+    }
+
+    // exact long names are resolved in constant time via the tables
+    if (table != NULL)
+    {
+        CCMD_INSTRUMENT_ADD(result, option_comparisons, 1);
+        const int index = ccmd_option_table_find_long(table, element->value, element->length);
+        if (index >= 0)
+        {
+            return index;
+        }
+    }
+
+    // anything else could be an abbreviation
+    if (node != NULL)
+    {
+        CCMD_INSTRUMENT_ADD(result, option_comparisons, 1);
+        return ccmd_trie_find(&node->option_trie, element->value, element->length);
+    }
+
+    if (command->options.count <= 0)
+    {
+        return CCMD_NAME_NOT_FOUND;
+    }
+
+    CCMD_INSTRUMENT_ADD(result, option_comparisons, command->options.count);
+    return ccmd_find_abbreviation(&command->options.data[0].long_name, sizeof(ccmd_option), command->options.count, element->value, element->length);
+}
+
+// Same as ccmd_find_option but for subcommand names
+int ccmd_find_subcommand(ccmd_result* result, const ccmd_command* command, const ccmd_compiled_node* node, const ccmd_token* element)
+{
+    CCMD_INSTRUMENT_ADD(result, subcommand_lookups, 1);
+
+    // an empty argument would otherwise be an abbreviation of every subcommand
+    if (element->length <= 0)
+    {
+        return CCMD_NAME_NOT_FOUND;
+    }
+
+    if (node != NULL)
+    {
+        const int index = ccmd_hash_table_find(&node->subcommands, element->value, element->length);
+        return index >= 0 ? index : ccmd_trie_find(&node->subcommand_trie, element->value, element->length);
+    }
+
+    if (command->subcommands.count <= 0)
+    {
+        return CCMD_NAME_NOT_FOUND;
+    }
+    return ccmd_find_abbreviation(&command->subcommands.data[0].name, sizeof(ccmd_command), command->subcommands.count, element->value, element->length);
+}
+
+static const char* ccmd_suggest_option(const ccmd_command* command, const ccmd_compiled_node* node, const ccmd_token* element)
+{
+    if (element->type != CCMD_TOKEN_LONG_OPTION)
+    {
+        return NULL;
+    }
+
+    if (node != NULL)
+    {
+        return ccmd_suggest_name(node->options_by_length, NULL, 0, node->sorted_option_count, element->value, element->length);
+    }
+
+    return command->options.count > 0
+        ? ccmd_suggest_name(NULL, &command->options.data[0].long_name, sizeof(ccmd_option), command->options.count, element->value, element->length)
+        : NULL;
+}
+
+static const char* ccmd_suggest_subcommand(const ccmd_command* command, const ccmd_compiled_node* node, const ccmd_token* element)
+{
+    if (node != NULL)
+    {
+        return ccmd_suggest_name(node->subcommands_by_length, NULL, 0, command->subcommands.count, element->value, element->length);
+    }
+
+    return command->subcommands.count > 0
+        ? ccmd_suggest_name(NULL, &command->subcommands.data[0].name, sizeof(ccmd_command), command->subcommands.count, element->value, element->length)
+        : NULL;
+}
+
+ccmd_status ccmd_parse_command(const int argc, char* const* argv, const ccmd_arg_info* arg_infos, ccmd_parser* parser);
+
+// Counts every positional and required option that wasn't parsed, adding an error for each if `add_errors` is set.
+// Positionals are always filled in order so the ones that were seen are just the first `positional_count`
+static int ccmd_check_missing(ccmd_result* result, const ccmd_command* command_info, const int32_t positional_count, const uint64_t* seen_options, const bool add_errors)
+{
+    const int64_t validate_begin = CCMD_INSTRUMENT_BEGIN(result);
+    int missing = CPLATFORM_MAX(command_info->positionals.count - positional_count, 0);
+    for (int i = positional_count; i < command_info->positionals.count && add_errors; ++i)
+    {
+        ccmd_add_error(result, CCMD_ERROR_CATEGORY_MISSING_REQUIRED_ARGUMENT, CCMD_ARGUMENT_POSITIONAL,
+            '\0', command_info->positionals.data[i].name, 1
+        );
+    }
+
+    for (int i = 0; i < command_info->options.count; ++i)
+    {
+        if (!command_info->options.data[i].required || (seen_options[i / 64] & (UINT64_C(1) << (i % 64))) != 0)
+        {
+            continue;
+        }
+
+        ++missing;
+        if (add_errors)
+        {
+            ccmd_add_error(result, CCMD_ERROR_CATEGORY_MISSING_REQUIRED_ARGUMENT, CCMD_ARGUMENT_OPTION,
+                command_info->options.data[i].short_name,
+                command_info->options.data[i].long_name,
+                command_info->options.data[i].nargs
+            );
+        }
+    }
+
+    // validation happens in the middle of matching so take its time back out of the match phase
+    CCMD_INSTRUMENT_END_NESTED(result, CCMD_PHASE_VALIDATE, CCMD_PHASE_MATCH, validate_begin);
+    return missing;
+}
+
+static int32_t ccmd_find_choice(const ccmd_option* option, const ccmd_hash_table* table, const char* arg)
+{
+    if (table != NULL)
+    {
+        return ccmd_hash_table_find(table, arg, (int32_t)strlen(arg));
+    }
+
+    for (int i = 0; i < option->choices.count; ++i)
+    {
+        if (strcmp(option->choices.data[i], arg) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static ccmd_status ccmd_parse_command_args(const int argc, char* const* argv, const ccmd_arg_info* arg_infos, ccmd_parser* parser, uint64_t* seen_options)
+{
+    assert(parser->program_result->commands_count <= parser->program_result->commands.count);
+
+    // get command info
+    const int depth = parser->program_result->commands_count - 1;
+    const ccmd_command* command_info = parser->command_infos[depth];
+    const ccmd_compiled_node* command_node = parser->command_nodes != NULL ? parser->command_nodes[depth] : NULL;
+    ccmd_command_result* command_result = parser->command_result;
+
+    // setup command defaults - name and run callback
+    memset(command_result, 0, sizeof(ccmd_command_result));
+    command_result->info = command_info;
+    command_result->option_table = command_node != NULL ? command_node->options : command_info->option_table;
+
+    // dense id -> parsed option table. Ids are the option's index in the spec so there's one slot per declared option
+    int32_t* option_ids = NULL;
+    if (command_info->options.count > 0 && (parser->program_result->arena != NULL || parser->program_result->option_ids.data != NULL))
+    {
+        if (parser->program_result->arena != NULL)
+        {
+            option_ids = (int32_t*)ccmd_arena_alloc(parser->program_result->arena, sizeof(int32_t) * command_info->options.count);
+        }
+        else if (parser->option_id_count + command_info->options.count <= parser->program_result->option_ids.count)
+        {
+            option_ids = &parser->program_result->option_ids.data[parser->option_id_count];
+            parser->option_id_count += command_info->options.count;
+        }
+
+        if (option_ids == NULL)
+        {
+            ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INTERNAL, CCMD_ARGUMENT_INVALID,
+                '\0', "too many option ids to store - increase the size of `result->option_ids` or assign `result->arena`", 0
+            );
+            return CCMD_STATUS_ERROR;
+        }
+
+        memset(option_ids, 0xFF, sizeof(int32_t) * command_info->options.count);
+        command_result->option_ids = option_ids;
+    }
+
+    // the program command defaults to the name extracted from argv[0]
+    command_result->name = depth == 0 ? parser->program_result->program_name : NULL;
+    if (command_info->name != NULL)
+    {
+        command_result->name = command_info->name;
+    }
+
+    if (command_info->run != NULL)
+    {
+        command_result->run = command_info->run;
+    }
+
+    int nargs_parsed = 0;
+
+    while (nargs_parsed < argc)
+    {
+        char* const* argv_slice = argv + nargs_parsed;
+        ccmd_token token = ccmd_parse_element(parser, argv[nargs_parsed], &arg_infos[nargs_parsed]);
+        ++nargs_parsed;
+
+        switch (token.type)
+        {
+            case CCMD_TOKEN_INVALID:
+            {
+                // very dodgy - something went terribly wrong
+                ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INTERNAL, CCMD_ARGUMENT_INVALID,
+                    '\0', "invalid argument string detected", 0
+                );
                 return CCMD_STATUS_ERROR;
             }
-            case CCMD_TOKEN_DELIMITER:
+            case CCMD_TOKEN_DELIMITER:
+            {
+                // detected ' -- ' : everything after it is a positional of this command, even if it starts with a dash
+                const int remaining = argc - nargs_parsed;
+                if (remaining > 0 && command_result->positionals.data == NULL)
+                {
+                    command_result->positionals.data = argv + nargs_parsed;
+                }
+                else if (remaining > 0)
+                {
+                    // the positionals are a slice of argv so the ones before '--' have to be copied next to the rest
+                    const int before = command_result->positionals.count;
+                    char** merged = parser->program_result->arena != NULL
+                        ? (char**)ccmd_arena_alloc(parser->program_result->arena, sizeof(char*) * (before + remaining))
+                        : NULL;
+                    if (merged == NULL)
+                    {
+                        ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INTERNAL, CCMD_ARGUMENT_INVALID,
+                            '\0', "positionals on both sides of '--' can only be stored together if `result->arena` is assigned", 0
+                        );
+                        return CCMD_STATUS_ERROR;
+                    }
+                    memcpy(merged, command_result->positionals.data, sizeof(char*) * before);
+                    memcpy(merged + before, argv + nargs_parsed, sizeof(char*) * remaining);
+                    command_result->positionals.data = merged;
+                }
+                command_result->positionals.count += remaining;
+                return parser->program_result->error_count > 0 ? CCMD_STATUS_ERROR : CCMD_STATUS_SUCCESS;
+            }
+            case CCMD_TOKEN_SHORT_OPTION:
+            case CCMD_TOKEN_LONG_OPTION:
+            {
+                // one option per pass - a cluster of short flags like -abc goes around once for each letter until one
+                // of them takes the rest of the cluster as its value
+                do
+                {
+                    // exit early and show help if this is the implicit -h/--help option
+                    if (ccmd_is_help_option(&token))
+                    {
+                        return CCMD_STATUS_HELP;
+                    }
+
+                    // find the given option and validate if exists
+                    const int option_index = ccmd_find_option(parser->program_result, command_info, command_node, &token);
+
+                    if (option_index == CCMD_NAME_NOT_FOUND && token.type == CCMD_TOKEN_LONG_OPTION && strncmp("help", token.value, token.length) == 0)
+                    {
+                        return CCMD_STATUS_HELP;
+                    }
+
+                    if (option_index < 0)
+                    {
+                        ccmd_error* error = ccmd_add_error(parser->program_result,
+                            option_index == CCMD_NAME_AMBIGUOUS ? CCMD_ERROR_CATEGORY_AMBIGUOUS_ARGUMENT : CCMD_ERROR_CATEGORY_UNRECOGNIZED_ARGUMENT,
+                            CCMD_ARGUMENT_OPTION, '\0', token.value, token.length
+                        );
+                        if (error != NULL)
+                        {
+                            error->command = command_info;
+                            error->suggestion = option_index == CCMD_NAME_NOT_FOUND ? ccmd_suggest_option(command_info, command_node, &token) : NULL;
+                        }
+                        return CCMD_STATUS_ERROR;
+                    }
+
+                    // parse all the arguments for the option
+                    const ccmd_option* option_info = &command_info->options.data[option_index];
+
+                    // mark as seen so it isn't reported missing
+                    seen_options[option_index / 64] |= UINT64_C(1) << (option_index % 64);
+
+                    const bool is_n_or_more = option_info->nargs < 0;
+                    const int argc_remaining = argc - nargs_parsed;
+                    const int min_nargs = is_n_or_more ? option_info->nargs - CCMD_0_OR_MORE : option_info->nargs;
+                    const int max_nargs = is_n_or_more ? argc_remaining : option_info->nargs;
+                    const int option_args_begin = nargs_parsed;
+
+                    // a short flag leaves the rest of its cluster alone but any other attached text is the option's only argument
+                    char* attached = token.type == CCMD_TOKEN_LONG_OPTION || option_info->nargs != 0 ? token.attached : NULL;
+                    if (attached != NULL)
+                    {
+                        token.attached = NULL;
+                        if (option_info->nargs == 0 || min_nargs > 1)
+                        {
+                            ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INVALID_NARGS, is_n_or_more ? CCMD_ARGUMENT_OPTION_N_OR_MORE : CCMD_ARGUMENT_OPTION,
+                                option_info->short_name,
+                                option_info->long_name,
+                                min_nargs
+                            );
+                            return CCMD_STATUS_ERROR;
+                        }
+                    }
+
+                    // special narg range [1, argc]
+                    for (int i = 0; i < CPLATFORM_MIN(max_nargs, argc_remaining) && attached == NULL; ++i)
+                    {
+                        // we can't just verify argc we have to actually search through for the next '-/--'
+                        if (arg_infos[nargs_parsed].dashes > 0)
+                        {
+                            break;
+                        }
+                        ++nargs_parsed;
+                    }
+
+                    if (attached == NULL && nargs_parsed - option_args_begin < min_nargs)
+                    {
+                        ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INVALID_NARGS, CCMD_ARGUMENT_OPTION_N_OR_MORE,
+                            option_info->short_name,
+                            option_info->long_name,
+                            min_nargs
+                        );
+                        return CCMD_STATUS_ERROR;
+                    }
+
+                    if (attached == NULL && !is_n_or_more && nargs_parsed < max_nargs)
+                    {
+                        ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INVALID_NARGS, CCMD_ARGUMENT_OPTION,
+                            option_info->short_name,
+                            option_info->long_name,
+                            option_info->nargs
+                        );
+                        return CCMD_STATUS_ERROR;
+                    }
+
+                    // convert the arguments now so run callbacks don't have to
+                    char* const* option_args = attached != NULL ? &attached : &argv[option_args_begin];
+                    const int option_nargs = attached != NULL ? 1 : nargs_parsed - option_args_begin;
+                    ccmd_value* values = NULL;
+                    if (ccmd_option_has_values(option_info) && option_nargs > 0)
+                    {
+                        // without any storage for values they're still checked but only kept long enough to do that
+                        const bool store_values = parser->program_result->arena != NULL || parser->program_result->values.data != NULL;
+                        ccmd_value scratch;
+                        values = store_values ? ccmd_alloc_values(parser, option_nargs) : NULL;
+                        if (store_values && values == NULL)
+                        {
+                            ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INTERNAL, CCMD_ARGUMENT_INVALID,
+                                '\0', "too many option values to store - increase the size of `result->values` or assign `result->arena`", 0
+                            );
+                            return CCMD_STATUS_ERROR;
+                        }
+
+                        const ccmd_hash_table* choices = command_node != NULL && command_node->choices != NULL
+                            ? &command_node->choices[option_index]
+                            : NULL;
+                        for (int i = 0; i < option_nargs && option_info->choices.count > 0; ++i)
+                        {
+                            ccmd_value* value = values != NULL ? &values[i] : &scratch;
+                            value->choice = ccmd_find_choice(option_info, choices, option_args[i]);
+                            if (value->choice < 0)
+                            {
+                                ccmd_error* error = ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INVALID_CHOICE, CCMD_ARGUMENT_OPTION,
+                                    option_info->short_name,
+                                    option_info->long_name,
+                                    option_index
+                                );
+                                if (error != NULL)
+                                {
+                                    error->value = option_args[i];
+                                    error->command = command_info;
+                                }
+                                return CCMD_STATUS_ERROR;
+                            }
+                        }
+
+                        for (int i = 0; i < option_nargs && option_info->choices.count == 0; ++i)
+                        {
+                            if (!ccmd_parse_value(option_info->value_type, option_args[i], values != NULL ? &values[i] : &scratch))
+                            {
+                                ccmd_error* error = ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INVALID_VALUE, CCMD_ARGUMENT_OPTION,
+                                    option_info->short_name,
+                                    option_info->long_name,
+                                    option_info->value_type
+                                );
+                                if (error != NULL)
+                                {
+                                    error->value = option_args[i];
+                                    error->command = command_info;
+                                }
+                                return CCMD_STATUS_ERROR;
+                            }
+                        }
+                    }
+
+                    // option parse success - add a new parsed one
+                    ccmd_parsed_args* option_result = add_option(parser);
+                    if (option_result == NULL)
+                    {
+                        ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INTERNAL, CCMD_ARGUMENT_INVALID,
+                            '\0', "too many options to store - increase the size of `result->options` or assign `result->arena`", 0
+                        );
+                        return CCMD_STATUS_ERROR;
+                    }
+                    option_result->id = option_index;
+                    option_result->long_name = option_info->long_name;
+                    option_result->short_name = option_info->short_name;
+                    option_result->nargs = option_nargs;
+                    option_result->attached = attached;
+                    option_result->args = attached != NULL ? &option_result->attached : (option_info->nargs != 0 ? option_args : NULL);
+                    option_result->values = values;
+
+                    // the first occurrence wins, same as looking the option up by name
+                    if (option_ids != NULL && option_ids[option_index] < 0)
+                    {
+                        option_ids[option_index] = command_result->options.count - 1;
+                    }
+
+                    if (!ccmd_apply_action(parser->program_result, option_info, option_result->args, values, option_nargs))
+                    {
+                        ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INTERNAL, CCMD_ARGUMENT_INVALID,
+                            '\0', "too many arguments to append - increase the `capacity` of the option's ccmd_append_list", 0
+                        );
+                        return CCMD_STATUS_ERROR;
+                    }
+                } while (ccmd_next_cluster_option(&token));
+                break;
+            }
+            case CCMD_TOKEN_POSITIONAL:
+            {
+                // just add this to the positional array
+                ++parser->command_result->positionals.count;
+                if (parser->command_result->positionals.data == NULL)
+                {
+                    parser->command_result->positionals.data = argv_slice;
+                }
+                break;
+            }
+            case CCMD_TOKEN_SUBCOMMAND:
+            {
+                // if all the positionals have been parsed then this is either a subcommand or otherwise it's invalid
+                const int subcommand_index = ccmd_find_subcommand(parser->program_result, command_info, command_node, &token);
+
+                // invalid - no such command or an abbreviation of more than one
+                if (subcommand_index < 0)
+                {
+                    ccmd_error* error = ccmd_add_error(parser->program_result,
+                        subcommand_index == CCMD_NAME_AMBIGUOUS ? CCMD_ERROR_CATEGORY_AMBIGUOUS_ARGUMENT : CCMD_ERROR_CATEGORY_UNRECOGNIZED_ARGUMENT,
+                        CCMD_ARGUMENT_SUBCOMMAND, '\0', token.value, token.length
+                    );
+                    if (error != NULL)
+                    {
+                        error->command = command_info;
+                        error->suggestion = subcommand_index == CCMD_NAME_NOT_FOUND ? ccmd_suggest_subcommand(command_info, command_node, &token) : NULL;
+                    }
+                }
+
+                // ensure all required options were found before moving to a subparser - the caller reports them
+                if (subcommand_index < 0 || parser->program_result->error_count > 0
+                    || ccmd_check_missing(parser->program_result, command_info, command_result->positionals.count, seen_options, false) > 0)
+                {
+                    return CCMD_STATUS_ERROR;
+                }
+
+                // valid subcommand - recursively parse. Since positionals take precedence over subcommands this is fine
+                if (parser->program_result->commands_count >= parser->program_result->commands.count)
+                {
+                    ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INTERNAL, CCMD_ARGUMENT_INVALID,
+                        '\0', "too many subcommands to store - increase the size of `result->commands` or assign `result->arena`", 0
+                    );
+                    return CCMD_STATUS_ERROR;
+                }
+
+                // setup the parser for the next recursive subcommand parse call
+                parser->command_infos[parser->program_result->commands_count] = &command_info->subcommands.data[subcommand_index];
+                if (command_node != NULL)
+                {
+                    parser->command_nodes[parser->program_result->commands_count] = &parser->compiled->nodes[command_node->first_subcommand + subcommand_index];
+                }
+                parser->command_result = &parser->program_result->commands.data[parser->program_result->commands_count];
+                ++parser->program_result->commands_count;
+
+                // parse the subcommand
+                const int subcommand_argc = argc - nargs_parsed;
+                char* const* subcommand_argv = argv + nargs_parsed;
+                return ccmd_parse_command(subcommand_argc, subcommand_argv, arg_infos + nargs_parsed, parser);
+            }
+        }
+    }
+
+    return parser->program_result->error_count > 0 ? CCMD_STATUS_ERROR : CCMD_STATUS_SUCCESS;
+}
+
+ccmd_status ccmd_parse_command(const int argc, char* const* argv, const ccmd_arg_info* arg_infos, ccmd_parser* parser)
+{
+    const int depth = parser->program_result->commands_count - 1;
+    const ccmd_command* command_info = parser->command_infos[depth];
+    const ccmd_command_result* command_result = parser->command_result;
+
+    // one bit per option, set when it's parsed
+    const int seen_words = command_info->options.count / 64 + 1;
+    uint64_t* seen_options = CPLATFORM_ALLOCA_ARRAY(uint64_t, seen_words);
+    memset(seen_options, 0, sizeof(uint64_t) * seen_words);
+
+    const ccmd_status status = ccmd_parse_command_args(argc, argv, arg_infos, parser, seen_options);
+
+    // help doesn't need anything else and if a subcommand was parsed then this command was already checked
+    if (status == CCMD_STATUS_HELP || parser->program_result->commands_count - 1 != depth)
+    {
+        return status;
+    }
+
+    return ccmd_check_missing(parser->program_result, command_info, command_result->positionals.count, seen_options, true) > 0
+        ? CCMD_STATUS_ERROR
+        : status;
+}
+
+static int ccmd_count_subcommands(const ccmd_command* command)
+{
+    int count = 1 + command->subcommands.count; // self
+    if (command->subcommands.count > 0)
+    {
+        for (int i = 0; i < command->subcommands.count; ++i)
+        {
+            count += ccmd_count_subcommands(&command->subcommands.data[i]);
+        }
+    }
+    return count;
+}
+
+static void* ccmd_atomic_load_pointer(void* volatile* address)
+{
+#if CPLATFORM_COMPILER_MSVC == 1
+    return InterlockedCompareExchangePointer(address, NULL, NULL);
+#else
+    return __atomic_load_n(address, __ATOMIC_ACQUIRE);
+#endif // CPLATFORM_COMPILER_MSVC == 1
+}
+
+static bool ccmd_atomic_compare_exchange_pointer(void* volatile* address, void* expected, void* desired)
+{
+#if CPLATFORM_COMPILER_MSVC == 1
+    return InterlockedCompareExchangePointer(address, desired, expected) == expected;
+#else
+    return __atomic_compare_exchange_n(address, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif // CPLATFORM_COMPILER_MSVC == 1
+}
+
+static ccmd_usage_cache* ccmd_render_usage(const ccmd_command* const* commands, const int32_t command_count, const int32_t help_column, const int32_t width)
+{
+    // keep doubling the buffer until the whole message fits
+    for (int32_t capacity = 4096;; capacity *= 2)
+    {
+        ccmd_usage_cache* cache = (ccmd_usage_cache*)CCMD_MALLOC(sizeof(ccmd_usage_cache) + capacity);
+        if (cache == NULL)
+        {
+            return NULL;
+        }
+
+        cache->text[0] = '\0';
+        ccmd_formatter formatter = { .buffer_capacity = capacity, .buffer = cache->text };
+        ccmd_generate_usage(&formatter, command_count, commands, help_column, width);
+        if (!formatter.overflow)
+        {
+            cache->length = formatter.length;
+            cache->width = width;
+            return cache;
+        }
+
+        CCMD_FREE(cache);
+    }
+}
+
+static const ccmd_compiled_node* ccmd_find_compiled_node(const ccmd_compiled* compiled, const ccmd_command* const* commands, const int32_t command_count)
+{
+    // subcommand nodes are laid out in declaration order so each command's index in its parent maps directly to a node
+    const ccmd_compiled_node* node = &compiled->nodes[0];
+    for (int32_t i = 1; i < command_count; ++i)
+    {
+        node = &compiled->nodes[node->first_subcommand + (commands[i] - commands[i - 1]->subcommands.data)];
+    }
+    return node;
+}
+
+// Returns the usage text for a command path in a compiled spec, rendering and caching it on first use. Many threads
+// can race to render the same node - only one wins and the rest throw theirs away. Unwrapped text (`width` 0) is
+// always cached but wrapped text is only cached for the first width it's rendered at - returns NULL for any other
+// width so the caller renders it on the spot
+static const ccmd_usage_cache* ccmd_get_compiled_usage(const ccmd_compiled* compiled, const ccmd_command* const* commands, const int32_t command_count, const int32_t width)
+{
+    // the caches are the only mutable part of the compiled spec
+    ccmd_compiled_node* node = (ccmd_compiled_node*)ccmd_find_compiled_node(compiled, commands, command_count);
+    void* volatile* slot = width > 0 ? &node->help : &node->usage;
+    const ccmd_usage_cache* cached = (const ccmd_usage_cache*)ccmd_atomic_load_pointer(slot);
+    if (cached == NULL)
+    {
+        ccmd_usage_cache* rendered = ccmd_render_usage(commands, command_count, node->help_column, width);
+        if (rendered == NULL)
+        {
+            return NULL;
+        }
+
+        if (ccmd_atomic_compare_exchange_pointer(slot, NULL, rendered))
+        {
+            return rendered;
+        }
+
+        CCMD_FREE(rendered);
+        cached = (const ccmd_usage_cache*)ccmd_atomic_load_pointer(slot);
+    }
+
+    return cached->width == width ? cached : NULL;
+}
+
+// Walks the whole spec to find the deepest path, the most errors any one command can produce and the longest usage
+// message. `path` needs room for every command in the spec
+static bool ccmd_measure_capacity(const ccmd_command** path, const int32_t depth, const int32_t path_options, int32_t* max_depth, ccmd_capacity* capacity)
+{
+    const ccmd_command* command = path[depth];
+    *max_depth = CPLATFORM_MAX(*max_depth, depth + 1);
+    capacity->errors = CPLATFORM_MAX(capacity->errors, ccmd_max_command_errors(command));
+    capacity->option_ids = CPLATFORM_MAX(capacity->option_ids, path_options + command->options.count);
+    for (int i = 0; i < command->options.count; ++i)
+    {
+        // just a flag until the final count is known
+        capacity->values |= ccmd_option_has_values(&command->options.data[i]) ? 1 : 0;
+    }
+
+    ccmd_usage_cache* usage = ccmd_render_usage(path, depth + 1, 0, 0);
+    if (usage == NULL)
+    {
+        return false;
+    }
+    capacity->usage_bytes = CPLATFORM_MAX(capacity->usage_bytes, usage->length + 1);
+    CCMD_FREE(usage);
+
+    for (int i = 0; i < command->subcommands.count; ++i)
+    {
+        path[depth + 1] = &command->subcommands.data[i];
+        if (!ccmd_measure_capacity(path, depth + 1, path_options + command->options.count, max_depth, capacity))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void ccmd_write(const ccmd_writer* writer, const char* data, const int32_t length)
+{
+    if (writer->write != NULL && length > 0)
+    {
+        writer->write(writer->user_data, data, length);
+    }
+}
+
+static int32_t ccmd_write_stdout(void* user_data, const char* data, const int32_t length)
+{
+    CPLATFORM_UNUSED(user_data);
+    return (int32_t)fwrite(data, 1, length, stdout);
+}
+
+static int32_t ccmd_write_stderr(void* user_data, const char* data, const int32_t length)
+{
+    CPLATFORM_UNUSED(user_data);
+    return (int32_t)fwrite(data, 1, length, stderr);
+}
+
+#if CPLATFORM_OS_WINDOWS == 0
+static int32_t ccmd_write_chunks_stream(FILE* stream, const ccmd_write_chunk* chunks, const int32_t count)
+{
+    // anything the program already printed with stdio has to come out first
+    fflush(stream);
+
+    struct iovec iov[CCMD_CONTEXT_CHUNK_MAX];
+    int32_t written = 0;
+    for (int32_t begin = 0; begin < count; begin += CCMD_CONTEXT_CHUNK_MAX)
+    {
+        const int32_t iov_count = CPLATFORM_MIN(count - begin, CCMD_CONTEXT_CHUNK_MAX);
+        for (int32_t i = 0; i < iov_count; ++i)
+        {
+            iov[i].iov_base = (void*)chunks[begin + i].data;
+            iov[i].iov_len = (size_t)chunks[begin + i].length;
+        }
+
+        // writev can stop short - skip past whatever was written and go again
+        struct iovec* remaining = iov;
+        int32_t remaining_count = iov_count;
+        while (remaining_count > 0)
+        {
+            const ssize_t result = writev(fileno(stream), remaining, remaining_count);
+            if (result < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return written;
+            }
+
+            written += (int32_t)result;
+            size_t consumed = (size_t)result;
+            while (remaining_count > 0 && consumed >= remaining->iov_len)
+            {
+                consumed -= remaining->iov_len;
+                ++remaining;
+                --remaining_count;
+            }
+
+            if (remaining_count > 0)
+            {
+                remaining->iov_base = (char*)remaining->iov_base + consumed;
+                remaining->iov_len -= consumed;
+            }
+        }
+    }
+
+    return written;
+}
+
+static int32_t ccmd_write_chunks_stdout(void* user_data, const ccmd_write_chunk* chunks, const int32_t count)
+{
+    CPLATFORM_UNUSED(user_data);
+    return ccmd_write_chunks_stream(stdout, chunks, count);
+}
+
+static int32_t ccmd_write_chunks_stderr(void* user_data, const ccmd_write_chunk* chunks, const int32_t count)
+{
+    CPLATFORM_UNUSED(user_data);
+    return ccmd_write_chunks_stream(stderr, chunks, count);
+}
+#else
+    #define ccmd_write_chunks_stdout NULL
+    #define ccmd_write_chunks_stderr NULL
+#endif // CPLATFORM_OS_WINDOWS == 0
+
+static int32_t ccmd_columns_from_env(void)
+{
+    const char* columns = getenv("COLUMNS");
+    if (columns == NULL)
+    {
+        return 0;
+    }
+
+    const long value = strtol(columns, NULL, 10);
+    return value > 0 && value < INT32_MAX ? (int32_t)value : 0;
+}
+
+// Columns to wrap help to when writing to stdout: $COLUMNS takes precedence like most shells expect, then the size
+// of the terminal stdout is attached to. Output that isn't going to a terminal uses CCMD_HELP_DEFAULT_WIDTH
+static int32_t ccmd_terminal_width(void)
+{
+    const int32_t columns = ccmd_columns_from_env();
+    if (columns > 0)
+    {
+        return columns;
+    }
+
+#if CPLATFORM_OS_WINDOWS == 1
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info))
+    {
+        return (int32_t)(info.srWindow.Right - info.srWindow.Left + 1);
+    }
+#else
+    struct winsize size;
+    if (ioctl(fileno(stdout), TIOCGWINSZ, &size) == 0 && size.ws_col > 0)
+    {
+        return (int32_t)size.ws_col;
+    }
+#endif // CPLATFORM_OS_WINDOWS == 1
+
+    return CCMD_HELP_DEFAULT_WIDTH;
+}
+
+// Resolves `ccmd_context::help_width` to the number of columns to wrap to or 0 to not wrap at all. Only called once
+// help is actually being written so the terminal is never queried on the parse path
+static int32_t ccmd_help_width(const ccmd_context* context)
+{
+    if (context->help_width != 0)
+    {
+        return CPLATFORM_MAX(context->help_width, 0);
+    }
+
+    // the default context writes to stdout so can wrap to the terminal it's attached to
+    if (context->out.write == ccmd_write_stdout)
+    {
+        return ccmd_terminal_width();
+    }
+
+    const int32_t columns = ccmd_columns_from_env();
+    return columns > 0 ? columns : CCMD_HELP_DEFAULT_WIDTH;
+}
+
+// Streams to `writer` through the context's buffer
+static ccmd_formatter ccmd_context_formatter(ccmd_context* context, const ccmd_writer* writer)
+{
+    ccmd_formatter formatter = {
+        .buffer_capacity = CCMD_ARRAY_SIZE(context->buffer),
+        .buffer = context->buffer,
+        .sink = writer,
+        .chunks = context->chunks,
+        .chunk_capacity = CCMD_ARRAY_SIZE(context->chunks),
+    };
+    formatter.buffer[0] = '\0';
+    return formatter;
+}
+
+static void ccmd_extract_program_name(ccmd_result* result)
+{
+    memset(result->program_name, 0, CCMD_PROGRAM_NAME_MAX);
+
+    // use the explicitly-specified name if one was provided
+    if (result->program_path == NULL)
+    {
+        return;
+    }
+
+    // otherwise try and discover the program name from the program path if there are any args
+    const int program_path_len = (int)strlen(result->program_path);
+
+    // get the filename from the program path (i.e. program.exe)
+    const char* exe_name = result->program_path;
+    for (int i = 0; i < program_path_len; ++i)
+    {
+        if (result->program_path[i] != CPLATFORM_PATH_SEPARATOR || i >= program_path_len - 1)
+        {
+            continue;
+        }
+
+        exe_name = &result->program_path[i + 1];
+    }
+
+    // assign the program name and then try and remove the extension if one exists
+CPLATFORM_PUSH_WARNING
+    CPLATFORM_DISABLE_WARNING_GCC(-Wstringop-overflow)
+    const int full_exe_name = CPLATFORM_MIN(strlen(exe_name), CCMD_PROGRAM_NAME_MAX);
+    strncpy(result->program_name, exe_name, full_exe_name);
+CPLATFORM_POP_WARNING
+
+    // get the length of the default program name up to the extension and remove it, i.e. program.exe -> program
+    // adjust the command line to exclude the program path
+    int last_dot = full_exe_name;
+    for (int i = 0; i < full_exe_name; ++i)
+    {
+        if (result->program_name[i] == '.')
+        {
+            last_dot = i;
+        }
+    }
+
+    if (last_dot < CCMD_PROGRAM_NAME_MAX)
+    {
+        // zero-out the remaining path
+        memset(result->program_name + last_dot, 0, CCMD_PROGRAM_NAME_MAX - last_dot);
+    }
+}
+
+/*
+ *****************************
+ *
+ * Shell completion
+ *
+ *****************************
+ */
+static int ccmd_qsort_sorted_name_comp(const void* lhs, const void* rhs)
+{
+    return strcmp(((const ccmd_sorted_name*)lhs)->name, ((const ccmd_sorted_name*)rhs)->name);
+}
+
+static int ccmd_qsort_name_length_comp(const void* lhs, const void* rhs)
+{
+    const ccmd_sorted_name* lhs_name = (const ccmd_sorted_name*)lhs;
+    const ccmd_sorted_name* rhs_name = (const ccmd_sorted_name*)rhs;
+    if (lhs_name->length != rhs_name->length)
+    {
+        return lhs_name->length - rhs_name->length;
+    }
+
+    // declaration order breaks ties so suggestions are stable
+    return lhs_name->index - rhs_name->index;
+}
+
+// Index of the first entry in `names` that sorts at or after `prefix` - every name starting with the prefix follows it
+static int32_t ccmd_sorted_names_lower_bound(const ccmd_sorted_name* names, const int32_t count, const char* prefix)
+{
+    int32_t begin = 0;
+    int32_t end = count;
+    while (begin < end)
+    {
+        const int32_t middle = begin + (end - begin) / 2;
+        if (strcmp(names[middle].name, prefix) < 0)
+        {
+            begin = middle + 1;
+        }
+        else
+        {
+            end = middle;
+        }
+    }
+    return begin;
+}
+
+static void ccmd_complete_candidate(ccmd_formatter* formatter, const char* dashes, const char* name, const char* prefix, const int32_t prefix_length)
+{
+    if (name == NULL || strncmp(name, prefix, prefix_length) != 0)
+    {
+        return;
+    }
+
+    ccmd_fmt_puts(formatter, dashes);
+    ccmd_fmt_puts(formatter, name);
+    ccmd_fmt_putc(formatter, '\n');
+}
+
+static void ccmd_complete_long_options(ccmd_formatter* formatter, const ccmd_command* command, const ccmd_compiled_node* node, const char* prefix)
+{
+    const int32_t prefix_length = (int32_t)strlen(prefix);
+    ccmd_complete_candidate(formatter, "--", "help", prefix, prefix_length);
+
+    if (node == NULL)
+    {
+        for (int i = 0; i < command->options.count; ++i)
+        {
+            ccmd_complete_candidate(formatter, "--", command->options.data[i].long_name, prefix, prefix_length);
+        }
+        return;
+    }
+
+    // only the matching range of the sorted names is visited
+    for (int32_t i = ccmd_sorted_names_lower_bound(node->sorted_options, node->sorted_option_count, prefix); i < node->sorted_option_count; ++i)
+    {
+        if (strncmp(node->sorted_options[i].name, prefix, prefix_length) != 0)
+        {
+            break;
+        }
+        ccmd_complete_candidate(formatter, "--", node->sorted_options[i].name, prefix, prefix_length);
+    }
+}
+
+static void ccmd_complete_subcommands(ccmd_formatter* formatter, const ccmd_command* command, const ccmd_compiled_node* node, const char* prefix)
+{
+    const int32_t prefix_length = (int32_t)strlen(prefix);
+    if (node == NULL)
+    {
+        for (int i = 0; i < command->subcommands.count; ++i)
+        {
+            ccmd_complete_candidate(formatter, "", command->subcommands.data[i].name, prefix, prefix_length);
+        }
+        return;
+    }
+
+    for (int32_t i = ccmd_sorted_names_lower_bound(node->sorted_subcommands, command->subcommands.count, prefix); i < command->subcommands.count; ++i)
+    {
+        if (strncmp(node->sorted_subcommands[i].name, prefix, prefix_length) != 0)
+        {
+            break;
+        }
+        ccmd_complete_candidate(formatter, "", node->sorted_subcommands[i].name, prefix, prefix_length);
+    }
+}
+
+// Answers `prog __complete <cword> <words...>` where `words` is the whole command line as the shell split it
+// (including the program name) and `cword` is the index of the word being completed. Walks the spec the same way
+// the parser would and writes every candidate for that word to the out writer, one per line
+static ccmd_status ccmd_complete(ccmd_context* context, ccmd_result* result, const int32_t word_count, char* const* words, const char* cword_arg, const ccmd_command* cli, const ccmd_compiled* compiled)
+{
+    result->compiled = compiled;
+    result->option_count = 0;
+    result->commands_count = 0;
+    result->error_count = 0;
+
+    char* end = NULL;
+    const long cword = strtol(cword_arg, &end, 10);
+    if (context->out.write == NULL || end == cword_arg || *end != '\0' || cword < 1 || cword > word_count)
+    {
+        return CCMD_STATUS_COMPLETE;
+    }
+
+    const ccmd_command* command = cli;
+    const ccmd_compiled_node* node = compiled != NULL ? &compiled->nodes[0] : NULL;
+    const ccmd_option* pending = NULL; // option whose arguments are still being read
+    int32_t pending_args = 0;
+    int32_t positional_count = 0;
+
+    for (int32_t i = 1; i < cword; ++i)
+    {
+        char* word = words[i];
+        if (pending != NULL && pending_args > 0 && (pending->nargs > 0 || word[0] != '-'))
+        {
+            --pending_args;
+            continue;
+        }
+        pending = NULL;
+
+        ccmd_arg_info info;
+        ccmd_scan_args_scalar(1, &words[i], &info);
+        ccmd_token token = ccmd_tokenize(word, &info);
+        if (token.type == CCMD_TOKEN_DELIMITER)
+        {
+            // everything after '--' is a positional so there's nothing left to complete
+            return CCMD_STATUS_COMPLETE;
+        }
+
+        if (token.type == CCMD_TOKEN_SHORT_OPTION || token.type == CCMD_TOKEN_LONG_OPTION)
+        {
+            // walk a cluster the same way the parser does - the first letter that takes arguments swallows the rest of
+            // it and only waits on the following words if there wasn't anything left
+            do
+            {
+                const int index = ccmd_find_option(result, command, node, &token);
+                if (index >= 0 && command->options.data[index].nargs != 0)
+                {
+                    pending = token.attached == NULL ? &command->options.data[index] : NULL;
+                    pending_args = command->options.data[index].nargs > 0 ? command->options.data[index].nargs : INT32_MAX;
+                    break;
+                }
+            } while (ccmd_next_cluster_option(&token));
+            continue;
+        }
+
+        // words are only subcommands once all the positionals are filled, just like when parsing. Empty words never
+        // name a subcommand
+        token.type = CCMD_TOKEN_SUBCOMMAND;
+        const int index = positional_count >= command->positionals.count && token.value != NULL
+            ? ccmd_find_subcommand(result, command, node, &token)
+            : -1;
+        if (index < 0)
+        {
+            ++positional_count;
+            continue;
+        }
+
+        command = &command->subcommands.data[index];
+        node = node != NULL ? &compiled->nodes[node->first_subcommand + index] : NULL;
+        positional_count = 0;
+    }
+
+    const char* current = cword < word_count ? words[cword] : "";
+    ccmd_formatter formatter = ccmd_context_formatter(context, &context->out);
+
+    ccmd_token current_token = { CCMD_TOKEN_INVALID, NULL, 0, NULL, 0 };
+    if (current[0] == '-' && current[1] == '-')
+    {
+        ccmd_arg_info info;
+        ccmd_scan_args_scalar(1, &words[cword], &info);
+        current_token = ccmd_tokenize(words[cword], &info);
+    }
+
+    if (pending != NULL && pending_args > 0 && (pending->nargs > 0 || current[0] != '-'))
+    {
+        // an option's argument - only its choices can be suggested
+        const int32_t prefix_length = (int32_t)strlen(current);
+        for (int i = 0; i < pending->choices.count; ++i)
+        {
+            ccmd_complete_candidate(&formatter, "", pending->choices.data[i], current, prefix_length);
+        }
+    }
+    else if (current_token.type == CCMD_TOKEN_LONG_OPTION && current_token.attached != NULL)
+    {
+        // --name=value - the value is completed from the option's choices and each candidate keeps the `--name=` so
+        // it replaces the whole word
+        const int index = ccmd_find_option(result, command, node, &current_token);
+        const ccmd_option* option = index >= 0 ? &command->options.data[index] : NULL;
+        const int32_t name_length = (int32_t)(current_token.attached - current);
+        for (int i = 0; option != NULL && option->nargs != 0 && i < option->choices.count; ++i)
+        {
+            if (strncmp(option->choices.data[i], current_token.attached, current_token.attached_length) == 0)
+            {
+                ccmd_fmt_write(&formatter, current, name_length);
+                ccmd_fmt_puts(&formatter, option->choices.data[i]);
+                ccmd_fmt_putc(&formatter, '\n');
+            }
+        }
+    }
+    else if (current[0] == '-')
+    {
+        if (current[1] == '\0')
+        {
+            ccmd_fmt_puts(&formatter, "-h\n");
+            for (int i = 0; i < command->options.count; ++i)
+            {
+                if (command->options.data[i].short_name != '\0')
+                {
+                    const char short_option[] = { '-', command->options.data[i].short_name, '\n', '\0' };
+                    ccmd_fmt_puts(&formatter, short_option);
+                }
+            }
+        }
+
+        if (current[1] == '\0' || current[1] == '-')
+        {
+            ccmd_complete_long_options(&formatter, command, node, current[1] == '\0' ? "" : current + 2);
+        }
+    }
+    else if (positional_count >= command->positionals.count)
+    {
+        ccmd_complete_subcommands(&formatter, command, node, current);
+    }
+
+    ccmd_fmt_flush(&formatter);
+    return CCMD_STATUS_COMPLETE;
+}
+
+// Turns a program name into something usable as a shell function name
+static void ccmd_completion_function_name(const char* program_name, char* function_name, const int32_t capacity)
+{
+    int32_t length = 0;
+    for (; program_name[length] != '\0' && length < capacity - 1; ++length)
+    {
+        const char c = program_name[length];
+        const bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        function_name[length] = valid ? c : '_';
+    }
+    function_name[length] = '\0';
+}
+
+int32_t ccmd_generate_completion_script(const ccmd_shell shell, const char* program_name, char* buffer, const int32_t buffer_size)
+{
+    char function_name[CCMD_PROGRAM_NAME_MAX];
+    ccmd_completion_function_name(program_name, function_name, CCMD_PROGRAM_NAME_MAX);
+
+    int length = 0;
+    switch (shell)
+    {
+        case CCMD_SHELL_BASH:
+        {
+            length = snprintf(buffer, buffer_size,
+                "# keep --name=value in one word so the value can be completed\n"
+                "COMP_WORDBREAKS=${COMP_WORDBREAKS//=/}\n"
+                "_%s_complete()\n"
+                "{\n"
+                "    local IFS=$'\\n'\n"
+                "    COMPREPLY=($(\"%s\" " CCMD_COMPLETE_COMMAND " \"$COMP_CWORD\" \"${COMP_WORDS[@]}\" 2>/dev/null))\n"
+                "}\n"
+                "complete -o default -F _%s_complete %s\n",
+                function_name, program_name, function_name, program_name
+            );
+            break;
+        }
+        case CCMD_SHELL_ZSH:
+        {
+            length = snprintf(buffer, buffer_size,
+                "#compdef %s\n"
+                "_%s_complete()\n"
+                "{\n"
+                "    compadd -- ${(f)\"$(\"%s\" " CCMD_COMPLETE_COMMAND " $((CURRENT - 1)) \"${words[@]}\" 2>/dev/null)\"}\n"
+                "}\n"
+                "compdef _%s_complete %s\n",
+                program_name, function_name, program_name, function_name, program_name
+            );
+            break;
+        }
+        case CCMD_SHELL_FISH:
+        {
+            length = snprintf(buffer, buffer_size,
+                "function __%s_complete\n"
+                "    set -l words (commandline -opc)\n"
+                "    \"%s\" " CCMD_COMPLETE_COMMAND " (count $words) $words (commandline -ct) 2>/dev/null\n"
+                "end\n"
+                "complete -c %s -f -a '(__%s_complete)'\n",
+                function_name, program_name, program_name, function_name
+            );
+            break;
+        }
+        default:
+        {
+            if (buffer_size > 0)
+            {
+                buffer[0] = '\0';
+            }
+            break;
+        }
+    }
+
+    return length;
+}
+
+// `previous` is an optional result from the same batch whose program name can be reused
+// `input_error` is an optional error found while preparing the arguments, i.e. when splitting a line - if it's set
+// nothing is parsed and it's reported like any other error
+// `allow_completion` is only set by entry points given a real program argv so lines read from elsewhere can never
+// trigger a completion request
+static ccmd_status ccmd_parse_with_context(ccmd_context* context, ccmd_result* result, int32_t argc, char* const* argv, const ccmd_command* cli, const ccmd_compiled* compiled, const ccmd_result* previous, const ccmd_error* input_error, const bool allow_completion)
+{
+    static const char commands_view_error[] = "the `result->commands` array view is NULL or invalid. This must be assigned before calling ccmd_parse\n";
+    static const char options_view_error[] = "the `result->options` array view is NULL or invalid. This must be assigned before calling ccmd_parse\n";
+    static const char allocation_error[] = "failed to allocate memory for the command line arguments\n";
+    static const char response_files_error[] = "`result->arena` must be assigned to use response files\n";
+
+    CCMD_INSTRUMENT_ADD(result, parses, 1);
+
+    // `prog __complete <cword> <words...>` lists completions for the shell instead of parsing anything
+    if (allow_completion && result->completion && argc >= 3 && input_error == NULL && strcmp(argv[1], CCMD_COMPLETE_COMMAND) == 0)
+    {
+        result->program_path = argv[0];
+        ccmd_extract_program_name(result);
+        return ccmd_complete(context, result, argc - 3, argv + 3, argv[2], cli, compiled);
+    }
+
+    const int64_t tokenize_begin = CCMD_INSTRUMENT_BEGIN(result);
+
+    // expand @file arguments before anything else is sized from argc. The program name is never expanded
+    ccmd_arg_expander expander;
+    expander.error = -1;
+    if (result->response_files && argc > 1 && input_error == NULL)
+    {
+        if (result->arena == NULL)
+        {
+            ccmd_write(&context->err, response_files_error, (int32_t)sizeof(response_files_error) - 1);
+            return CCMD_STATUS_ERROR;
+        }
+
+        expander.arena = result->arena;
+        expander.argc = 0;
+        expander.capacity = 0;
+        expander.argv = NULL;
+        expander.depth = 0;
+        expander.error_path = NULL;
+        if (ccmd_push_expanded_arg(&expander, argv[0]))
+        {
+            ccmd_expand_response_files(&expander, argc - 1, argv + 1);
+        }
+        else
+        {
+            expander.error = CCMD_RESPONSE_FILE_ERROR_ALLOCATION;
+            expander.error_path = argv[0];
+        }
+
+        if (expander.error < 0)
+        {
+            argc = expander.argc;
+            argv = expander.argv;
+        }
+    }
+
+    ccmd_error response_file_error;
+    if (expander.error >= 0)
+    {
+        response_file_error.key = CCMD_ERROR_KEY(CCMD_ERROR_CATEGORY_RESPONSE_FILE, CCMD_ARGUMENT_INVALID);
+        response_file_error.int32 = expander.error;
+        response_file_error.char8 = '\0';
+        response_file_error.str = expander.error_path;
+        input_error = &response_file_error;
+    }
+
+    // every subcommand consumes at least one argument so the arena storage is sized from argc and never needs to grow
+    // mid-parse. Options are sized once the arguments have been classified
+    if (result->arena != NULL)
+    {
+        const int32_t args = CPLATFORM_MAX(argc - 1, 0);
+        const int32_t commands = compiled != NULL ? CPLATFORM_MIN(compiled->max_depth, args + 1) : args + 1;
+        result->commands.data = (ccmd_command_result*)ccmd_arena_alloc(result->arena, sizeof(ccmd_command_result) * commands);
+        result->commands.count = result->commands.data != NULL ? commands : 0;
+        if (result->commands.data == NULL)
+        {
+            ccmd_write(&context->err, allocation_error, (int32_t)sizeof(allocation_error) - 1);
+            return CCMD_STATUS_ERROR;
+        }
+    }
+
+    if (result->commands.data == NULL || result->commands.count <= 0)
+    {
+        ccmd_write(&context->err, commands_view_error, (int32_t)sizeof(commands_view_error) - 1);
+        return CCMD_STATUS_ERROR;
+    }
+
+    if (result->arena == NULL && (result->options.data == NULL || result->options.count <= 0))
+    {
+        ccmd_write(&context->err, options_view_error, (int32_t)sizeof(options_view_error) - 1);
+        return CCMD_STATUS_ERROR;
+    }
+
+    // defaults for the result
+    result->program_path = "";
+    result->program_command = NULL;
+    result->compiled = compiled;
+    result->option_count = 0;
+    result->commands_count = 0;
+    result->error_count = 0;
+
+    int subcommand_argc = argc;
+    char* const* subcommand_argv = argv;
+
+    // Check if empty args -- this should only occur with an adhoc command line, not one generated by the OS
+    if (argc > 0)
+    {
+        assert(argv[0] != NULL);
+
+        // Otherwise it's a normal command line
+        result->program_path = argv[0];
+
+        // adjust command args to skip program name
+        subcommand_argc = argc - 1;
+        subcommand_argv = argv + 1;
+    }
+
+    if (previous != NULL && previous->program_path != NULL && strcmp(previous->program_path, result->program_path) == 0)
+    {
+        // same program as the last command line in a batch - no need to extract the name again
+        memcpy(result->program_name, previous->program_name, CCMD_PROGRAM_NAME_MAX);
+    }
+    else
+    {
+        ccmd_extract_program_name(result);
+    }
+
+    // Set default name for the program command, otherwise it will be assigned in the parse_command call if cli defines one
+    ccmd_command_result* program_command = &result->commands.data[0];
+    program_command->name = result->program_name;
+    result->program_command = program_command;
+
+    // compiled specs already know the maximum depth of the tree so there's no need to walk it
+    const ccmd_command** parsed_commands = NULL;
+    const ccmd_compiled_node** parsed_nodes = NULL;
+    if (compiled != NULL)
+    {
+        parsed_commands = CPLATFORM_ALLOCA_ARRAY(const ccmd_command*, compiled->max_depth);
+        parsed_nodes = CPLATFORM_ALLOCA_ARRAY(const ccmd_compiled_node*, compiled->max_depth);
+        parsed_nodes[0] = &compiled->nodes[0];
+    }
+    else
+    {
+        const int total_subcommand_count = ccmd_count_subcommands(cli);
+        parsed_commands = CPLATFORM_ALLOCA_ARRAY(const ccmd_command*, sizeof(const ccmd_command*) * total_subcommand_count);
+    }
+    parsed_commands[0] = cli;
+
+    // classify every argument in one sweep up-front so the parser never has to rescan argv
+    ccmd_arg_info stack_arg_infos[CCMD_ARG_INFO_STACK_MAX];
+    ccmd_arg_info* arg_infos = stack_arg_infos;
+    if (subcommand_argc > CCMD_ARG_INFO_STACK_MAX)
+    {
+        arg_infos = result->arena != NULL
+            ? (ccmd_arg_info*)ccmd_arena_alloc(result->arena, sizeof(ccmd_arg_info) * subcommand_argc)
+            : (ccmd_arg_info*)CCMD_MALLOC(sizeof(ccmd_arg_info) * subcommand_argc);
+        if (arg_infos == NULL)
+        {
+            ccmd_write(&context->err, allocation_error, (int32_t)sizeof(allocation_error) - 1);
+            return CCMD_STATUS_ERROR;
+        }
+    }
+    ccmd_select_scan_args()(subcommand_argc, subcommand_argv, arg_infos);
+    CCMD_INSTRUMENT_ADD(result, tokens_classified, subcommand_argc);
+
+    // a short cluster can hold an option per letter, any other argument starting with a dash at most one
+    if (result->arena != NULL)
+    {
+        int32_t options = 0;
+        for (int32_t i = 0; i < subcommand_argc; ++i)
+        {
+            options += arg_infos[i].dashes > 0 ? ccmd_max_argument_options(subcommand_argv[i], arg_infos[i].length) : 0;
+        }
+        options = CPLATFORM_MAX(options, 1);
+
+        result->options.data = (ccmd_parsed_args*)ccmd_arena_alloc(result->arena, sizeof(ccmd_parsed_args) * options);
+        result->options.count = result->options.data != NULL ? options : 0;
+        if (result->options.data == NULL)
+        {
+            ccmd_write(&context->err, allocation_error, (int32_t)sizeof(allocation_error) - 1);
+            return CCMD_STATUS_ERROR;
+        }
+    }
+    CCMD_INSTRUMENT_END(result, CCMD_PHASE_TOKENIZE, tokenize_begin);
+
+    // errors are only reported to the error writer if the caller didn't ask for them to be redirected
+    const bool report_errors = result->errors.data == NULL;
+    if (report_errors)
+    {
+        CCMD_ARRAY_VIEW_INPLACE(result->errors, context->errors);
+    }
+
+    const int64_t match_begin = CCMD_INSTRUMENT_BEGIN(result);
+    ccmd_status status = CCMD_STATUS_ERROR;
+    if (input_error != NULL)
+    {
+        // nothing was parsed so only the program command is valid
+        memset(program_command, 0, sizeof(ccmd_command_result));
+        program_command->name = cli->name != NULL ? cli->name : result->program_name;
+        program_command->info = cli;
+        result->commands_count = 1;
+        ccmd_add_error(result,
+            (ccmd_error_category)CCMD_ERROR_KEY_CATEGORY(input_error->key),
+            (ccmd_argument_type)CCMD_ERROR_KEY_ARG_TYPE(input_error->key),
+            input_error->char8,
+            input_error->str,
+            input_error->int32
+        );
+    }
+    else
+    {
+        status = ccmd_parse_command(subcommand_argc, subcommand_argv, arg_infos, &(ccmd_parser) {
+            .compiled = compiled,
+            .command_result = &result->commands.data[result->commands_count++],
+            .command_infos = parsed_commands,
+            .command_nodes = parsed_nodes,
+            .program_result = result,
+        });
+    }
+
+    CCMD_INSTRUMENT_END(result, CCMD_PHASE_MATCH, match_begin);
+
+    if (arg_infos != stack_arg_infos && result->arena == NULL)
+    {
+        CCMD_FREE(arg_infos);
+    }
+
+    const int64_t format_begin = CCMD_INSTRUMENT_BEGIN(result);
+    if (report_errors && status == CCMD_STATUS_ERROR && context->err.write != NULL)
+    {
+        ccmd_formatter formatter = ccmd_context_formatter(context, &context->err);
+        ccmd_default_error_report(program_command->name, &formatter, result);
+        ccmd_fmt_putc(&formatter, '\n');
+        ccmd_fmt_flush(&formatter);
+        CCMD_INSTRUMENT_ADD(result, error_bytes, ccmd_fmt_total(&formatter));
+    }
+
+    // usage is only generated if -h/--help was requested - otherwise it's built on demand by ccmd_get_usage
+    if (status == CCMD_STATUS_HELP && (result->usage.data != NULL || context->out.write != NULL))
+    {
+        // usage buffers are sized for the unwrapped text so only streamed help is wrapped
+        const int32_t width = result->usage.data != NULL ? 0 : ccmd_help_width(context);
+        const ccmd_usage_cache* cached = compiled != NULL
+            ? ccmd_get_compiled_usage(compiled, parsed_commands, result->commands_count, width)
+            : NULL;
+
+        // redirect to the usage buffer if one was assigned, otherwise stream to the out writer
+        ccmd_formatter formatter = result->usage.data != NULL
+            ? (ccmd_formatter) { .buffer_capacity = result->usage.count, .buffer = result->usage.data }
+            : ccmd_context_formatter(context, &context->out);
+
+        if (cached != NULL)
+        {
+            ccmd_fmt_write(&formatter, cached->text, cached->length);
+        }
+        else
+        {
+            const int32_t help_column = compiled != NULL
+                ? ccmd_find_compiled_node(compiled, parsed_commands, result->commands_count)->help_column
+                : 0;
+            ccmd_generate_usage(&formatter, result->commands_count, parsed_commands, help_column, width);
+        }
+        CCMD_INSTRUMENT_ADD(result, usage_bytes, ccmd_fmt_total(&formatter));
+
+        if (result->usage.data == NULL)
+        {
+            ccmd_fmt_putc(&formatter, '\n');
+            ccmd_fmt_flush(&formatter);
+        }
+    }
+
+    CCMD_INSTRUMENT_END(result, CCMD_PHASE_FORMAT, format_begin);
+
+    // don't leave the result pointing at context storage - the next parse would treat it as a caller-owned buffer.
+    // The first `result->error_count` errors stay readable in `context->errors` until it's used again
+    if (report_errors)
+    {
+        result->errors.data = NULL;
+        result->errors.count = 0;
+    }
+
+    return status;
+}
+
+static ccmd_status ccmd_parse_internal(ccmd_result* result, const int32_t argc, char* const* argv, const ccmd_command* cli, const ccmd_compiled* compiled, const ccmd_error* input_error, const bool allow_completion)
+{
+    if (result->context != NULL)
+    {
+        return ccmd_parse_with_context(result->context, result, argc, argv, cli, compiled, NULL, input_error, allow_completion);
+    }
+
+    // no context assigned - use the default one which reports to stdout/stderr. The buffers are only ever written
+    // before they're read so there's no need to clear them
+    ccmd_context context;
+    context.out = (ccmd_writer) { .write = ccmd_write_stdout, .write_chunks = ccmd_write_chunks_stdout };
+    context.err = (ccmd_writer) { .write = ccmd_write_stderr, .write_chunks = ccmd_write_chunks_stderr };
+    context.help_width = 0;
+    return ccmd_parse_with_context(&context, result, argc, argv, cli, compiled, NULL, input_error, allow_completion);
+}
+
+/*
+ *****************************
+ *
+ * Compiled command index
+ *
+ *****************************
+ */
+static uint32_t ccmd_hash_table_capacity(const int32_t count)
+{
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+    // keep the load factor at or below 50% so probe sequences stay short
+    uint32_t capacity = 4;
+    while (capacity < (uint32_t)count * 2)
+    {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+static void ccmd_hash_table_init(ccmd_hash_table* table, ccmd_hash_slot** slot_cursor, const int32_t count)
+{
+    const uint32_t capacity = ccmd_hash_table_capacity(count);
+    if (capacity == 0)
+    {
+        table->mask = 0;
+        table->slots = NULL;
+        return;
+    }
+
+    table->mask = capacity - 1;
+    table->slots = *slot_cursor;
+    *slot_cursor += capacity;
+}
+
+static void ccmd_hash_table_insert(ccmd_hash_table* table, const char* name, const int32_t index)
+{
+    if (name == NULL)
+    {
+        return;
+    }
+
+    const uint32_t hash = ccmd_hash_string(name, (int32_t)strlen(name));
+    for (uint32_t i = hash & table->mask;; i = (i + 1) & table->mask)
+    {
+        ccmd_hash_slot* slot = &table->slots[i];
+        if (slot->name == NULL)
+        {
+            slot->name = name;
+            slot->hash = hash;
+            slot->index = index;
+            return;
+        }
+
+        // duplicate names resolve to the first declaration, same as a linear search would
+        if (slot->hash == hash && strcmp(slot->name, name) == 0)
+        {
+            return;
+        }
+    }
+}
+
+static int32_t ccmd_find_applet(const ccmd_multicall* multicall, const char* name)
+{
+    return name != NULL ? ccmd_hash_table_find(&multicall->names, name, (int32_t)strlen(name)) : -1;
+}
+
+// Fills in `nodes[node]` for the sorted names in [begin, end), which all share their first `depth` characters
+static void ccmd_trie_fill(ccmd_trie_node* nodes, int32_t* node_count, const int32_t node, const ccmd_sorted_name* names, int32_t begin, const int32_t end, const int32_t depth)
+{
+    // the range is sorted so every name in it shares whatever prefix the first and last names do
+    const char* first = names[begin].name;
+    const char* last = names[end - 1].name;
+    int32_t shared = depth;
+    while (first[shared] != '\0' && first[shared] == last[shared])
+    {
+        ++shared;
+    }
+
+    ccmd_trie_node* trie_node = &nodes[node];
+    trie_node->label = first + depth;
+    trie_node->label_length = shared - depth;
+    trie_node->index = -1;
+
+    // names ending here sort before the rest. Duplicates resolve to the first declaration
+    for (; begin < end && names[begin].name[shared] == '\0'; ++begin)
+    {
+        trie_node->index = trie_node->index < 0 ? names[begin].index : CPLATFORM_MIN(trie_node->index, names[begin].index);
+    }
+
+    // anything left diverges right after the label so there's more than one name below unless nothing is left
+    trie_node->unique = begin == end ? trie_node->index : -1;
+
+    int32_t child_count = 0;
+    for (int32_t i = begin; i < end; ++child_count)
+    {
+        const char c = names[i].name[shared];
+        while (i < end && names[i].name[shared] == c)
+        {
+            ++i;
+        }
+    }
+
+    trie_node->first_child = *node_count;
+    trie_node->child_count = child_count;
+    *node_count += child_count;
+
+    int32_t child = trie_node->first_child;
+    for (int32_t i = begin; i < end; ++child)
+    {
+        const int32_t group_begin = i;
+        const char c = names[i].name[shared];
+        while (i < end && names[i].name[shared] == c)
+        {
+            ++i;
+        }
+        ccmd_trie_fill(nodes, node_count, child, names, group_begin, i, shared);
+    }
+}
+
+// Builds a trie from names sorted with ccmd_qsort_sorted_name_comp. A trie over `count` names never needs more than
+// `count * 2` nodes
+static ccmd_trie ccmd_trie_build(ccmd_trie_node** node_cursor, const ccmd_sorted_name* names, const int32_t count)
+{
+    ccmd_trie_node* nodes = *node_cursor;
+    int32_t node_count = 0;
+    if (count > 0)
+    {
+        node_count = 1;
+        ccmd_trie_fill(nodes, &node_count, 0, names, 0, count, 0);
+    }
+
+    *node_cursor += node_count;
+    return (ccmd_trie) { .nodes = nodes, .count = node_count };
+}
+
+static uint32_t ccmd_next_pow2(const uint32_t value)
+{
+    uint32_t result = 1;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+typedef struct ccmd_option_table_layout
+{
+    uint32_t    bucket_count;
+    uint32_t    slot_count;
+    size_t      size;
+} ccmd_option_table_layout;
+
+static ccmd_option_table_layout ccmd_option_table_get_layout(const ccmd_command* command)
+{
+    int32_t long_name_count = 0;
+    for (int i = 0; i < command->options.count; ++i)
+    {
+        long_name_count += command->options.data[i].long_name != NULL ? 1 : 0;
+    }
+
+    ccmd_option_table_layout layout = { 0, 0, sizeof(ccmd_option_table) };
+    if (long_name_count > 0)
+    {
+        // ~2 names per bucket and at most a 50% load factor keeps displacement search to a handful of tries
+        layout.bucket_count = ccmd_next_pow2((uint32_t)(long_name_count + 1) / 2);
+        layout.slot_count = ccmd_next_pow2((uint32_t)long_name_count * 2);
+        layout.size += sizeof(ccmd_option_slot) * layout.slot_count + sizeof(uint32_t) * layout.bucket_count;
+    }
+
+    layout.size = CPLATFORM_ROUND_UP(layout.size, sizeof(void*));
+    return layout;
+}
+
+typedef struct ccmd_option_table_entry
+{
+    uint64_t    hash;
+    int32_t     length;
+    int32_t     index;
+} ccmd_option_table_entry;
+
+// Builds an option table in `memory`, which must be at least `layout->size` bytes
+static ccmd_option_table* ccmd_option_table_build(void* memory, const ccmd_option_table_layout* layout, const ccmd_command* command)
+{
+    if (command->options.count > INT16_MAX)
+    {
+        return NULL;
+    }
+
+    ccmd_option_table* table = (ccmd_option_table*)memory;
+    memset(table, 0, layout->size);
+    memset(table->short_options, 0xFF, sizeof(table->short_options)); // all -1
+
+    for (int i = command->options.count - 1; i >= 0; --i)
+    {
+        // iterate in reverse so that the first declaration of a duplicate short name is the one that sticks
+        if (command->options.data[i].short_name != '\0')
+        {
+            table->short_options[(uint8_t)command->options.data[i].short_name] = (int16_t)i;
+        }
+    }
+
+    if (layout->slot_count == 0)
+    {
+        return table;
+    }
+
+    table->bucket_mask = layout->bucket_count - 1;
+    table->slot_mask = layout->slot_count - 1;
+    table->slots = (ccmd_option_slot*)(table + 1);
+    table->seeds = (uint32_t*)(table->slots + layout->slot_count);
+
+    // scratch: entries sorted by bucket, bucket offsets and buckets sorted by size
+    const size_t scratch_size = sizeof(ccmd_option_table_entry) * command->options.count
+        + sizeof(uint32_t) * (layout->bucket_count + 1) * 2
+        + sizeof(uint32_t) * layout->bucket_count;
+    char* scratch = (char*)CCMD_MALLOC(scratch_size);
+    if (scratch == NULL)
+    {
+        return NULL;
+    }
+
+    ccmd_option_table_entry* entries = (ccmd_option_table_entry*)scratch;
+    uint32_t* bucket_offsets = (uint32_t*)(entries + command->options.count);
+    uint32_t* bucket_cursors = bucket_offsets + layout->bucket_count + 1;
+    uint32_t* bucket_order = bucket_cursors + layout->bucket_count + 1;
+    memset(bucket_offsets, 0, sizeof(uint32_t) * (layout->bucket_count + 1) * 2);
+
+    // counting sort the names into their buckets, keeping declaration order within each bucket
+    int32_t entry_count = 0;
+    for (int i = 0; i < command->options.count; ++i)
+    {
+        const char* long_name = command->options.data[i].long_name;
+        if (long_name != NULL)
+        {
+            const int32_t length = (int32_t)strlen(long_name);
+            ++bucket_offsets[(ccmd_hash_string64(long_name, length) & table->bucket_mask) + 1];
+        }
+    }
+    for (uint32_t b = 0; b < layout->bucket_count; ++b)
+    {
+        bucket_offsets[b + 1] += bucket_offsets[b];
+        bucket_cursors[b] = bucket_offsets[b];
+    }
+    for (int i = 0; i < command->options.count; ++i)
+    {
+        const char* long_name = command->options.data[i].long_name;
+        if (long_name != NULL)
+        {
+            const int32_t length = (int32_t)strlen(long_name);
+            const uint64_t hash = ccmd_hash_string64(long_name, length);
+            entries[bucket_cursors[hash & table->bucket_mask]++] = (ccmd_option_table_entry) { hash, length, i };
+            ++entry_count;
+        }
+    }
+
+    // place the largest buckets first while the table is still mostly empty
+    for (uint32_t b = 0; b < layout->bucket_count; ++b)
+    {
+        bucket_order[b] = b;
+    }
+    for (uint32_t b = 1; b < layout->bucket_count; ++b)
+    {
+        const uint32_t bucket = bucket_order[b];
+        const uint32_t size = bucket_offsets[bucket + 1] - bucket_offsets[bucket];
+        uint32_t j = b;
+        for (; j > 0 && bucket_offsets[bucket_order[j - 1] + 1] - bucket_offsets[bucket_order[j - 1]] < size; --j)
+        {
+            bucket_order[j] = bucket_order[j - 1];
+        }
+        bucket_order[j] = bucket;
+    }
+
+    bool success = true;
+    for (uint32_t b = 0; b < layout->bucket_count && success; ++b)
+    {
+        const uint32_t bucket = bucket_order[b];
+        const uint32_t begin = bucket_offsets[bucket];
+        const uint32_t end = bucket_offsets[bucket + 1];
+        if (begin == end)
+        {
+            break; // the rest of the buckets are empty
+        }
+
+        // duplicate names always land in the same bucket - drop all but the first declaration
+        uint32_t unique_end = begin;
+        for (uint32_t e = begin; e < end; ++e)
+        {
+            bool duplicate = false;
+            for (uint32_t u = begin; u < unique_end && !duplicate; ++u)
+            {
+                duplicate = entries[u].hash == entries[e].hash
+                    && strcmp(command->options.data[entries[u].index].long_name, command->options.data[entries[e].index].long_name) == 0;
+            }
+            if (!duplicate)
+            {
+                entries[unique_end++] = entries[e];
+            }
+        }
+
+        // search for a displacement seed that puts every name in the bucket into a distinct, empty slot
+        uint32_t seed = 0;
+        for (; seed < (1u << 20); ++seed)
+        {
+            uint32_t e = begin;
+            for (; e < unique_end; ++e)
+            {
+                ccmd_option_slot* slot = &table->slots[ccmd_hash_displace(entries[e].hash, seed) & table->slot_mask];
+                if (slot->name != NULL)
+                {
+                    break;
+                }
+                // claim the slot for now so other names in this bucket can't also take it
+                slot->name = command->options.data[entries[e].index].long_name;
+            }
+
+            if (e == unique_end)
             {
-                // detected ' -- ' : game over, man
-                return CCMD_STATUS_SUCCESS;
+                break;
             }
-            case CCMD_TOKEN_SHORT_OPTION:
-            case CCMD_TOKEN_LONG_OPTION:
+
+            // collision - release the claimed slots and try the next seed
+            for (uint32_t r = begin; r < e; ++r)
             {
-                // exit early and show help if this is the implicit -h/--help option
-                if (ccmd_compare_option(&token, 'h', "help"))
-                {
-                    return CCMD_STATUS_HELP;
-                }
+                table->slots[ccmd_hash_displace(entries[r].hash, seed) & table->slot_mask].name = NULL;
+            }
+        }
 
-                // find the given option and validate if exists
-                const int option_index = ccmd_find_option(command_info, &token);
+        if (seed == (1u << 20))
+        {
+            success = false;
+            break;
+        }
 
-                if (option_index < 0)
-                {
-                    ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_UNRECOGNIZED_ARGUMENT, CCMD_ARGUMENT_OPTION,
-                        '\0', token.value, 0
-                    );
-                    return CCMD_STATUS_ERROR;
-                }
+        table->seeds[bucket] = seed;
+        for (uint32_t e = begin; e < unique_end; ++e)
+        {
+            ccmd_option_slot* slot = &table->slots[ccmd_hash_displace(entries[e].hash, seed) & table->slot_mask];
+            slot->length = entries[e].length;
+            slot->index = entries[e].index;
+        }
+    }
 
-                // parse all the arguments for the option
-                const ccmd_option* option_info = &command_info->options.data[option_index];
+    CCMD_FREE(scratch);
+    return success ? table : NULL;
+}
 
-                // Remove from list of missing required options
-                if (option_info->required)
-                {
-                    ccmd_remove_error(parser->program_result, CCMD_ERROR_CATEGORY_MISSING_REQUIRED_ARGUMENT, CCMD_ARGUMENT_OPTION, option_info->short_name, option_info->long_name);
-                }
+static void ccmd_compile_measure(const ccmd_command* command, const int32_t depth, const int32_t path_options, ccmd_compiled* compiled)
+{
+    ++compiled->node_count;
+    compiled->max_depth = CPLATFORM_MAX(compiled->max_depth, depth + 1);
+    compiled->option_count += command->options.count;
+    compiled->max_command_errors = CPLATFORM_MAX(compiled->max_command_errors, ccmd_max_command_errors(command));
+    compiled->max_path_options = CPLATFORM_MAX(compiled->max_path_options, path_options + command->options.count);
+    for (int i = 0; i < command->options.count; ++i)
+    {
+        compiled->has_values |= ccmd_option_has_values(&command->options.data[i]);
+    }
+    if (ccmd_command_has_choices(command))
+    {
+        compiled->choice_table_count += command->options.count;
+        for (int i = 0; i < command->options.count; ++i)
+        {
+            compiled->slot_count += (int32_t)ccmd_hash_table_capacity(command->options.data[i].choices.count);
+        }
+    }
+    compiled->slot_count += (int32_t)ccmd_hash_table_capacity(command->subcommands.count);
+    compiled->sorted_name_count += command->subcommands.count;
+    for (int i = 0; i < command->options.count; ++i)
+    {
+        compiled->sorted_name_count += command->options.data[i].long_name != NULL ? 1 : 0;
+    }
+    if (command->option_table == NULL)
+    {
+        compiled->option_tables_size += ccmd_option_table_get_layout(command).size;
+    }
 
-                const bool is_n_or_more = option_info->nargs < 0;
-                const int argc_remaining = argc - nargs_parsed;
-                const int min_nargs = is_n_or_more ? option_info->nargs - CCMD_0_OR_MORE : option_info->nargs;
-                const int max_nargs = is_n_or_more ? argc_remaining : option_info->nargs;
-                const int option_args_begin = nargs_parsed;
+    for (int i = 0; i < command->subcommands.count; ++i)
+    {
+        ccmd_compile_measure(&command->subcommands.data[i], depth + 1, path_options + command->options.count, compiled);
+    }
+}
 
-                // special narg range [1, argc]
-                for (int i = 0; i < CPLATFORM_MIN(max_nargs, argc_remaining); ++i)
-                {
-                    // we can't just verify argc we have to actually search through for the next '-/--'
-                    if (*(argv[nargs_parsed]) == '-')
-                    {
-                        break;
-                    }
-                    ++nargs_parsed;
-                }
+/*
+ *****************************
+ *
+ * Threading
+ *
+ *****************************
+ */
+#if CPLATFORM_OS_WINDOWS == 1
+typedef HANDLE ccmd_thread;
+typedef SRWLOCK ccmd_mutex;
+typedef CONDITION_VARIABLE ccmd_condition;
+typedef DWORD ccmd_thread_return;
+#define CCMD_THREAD_CALL WINAPI
+#else
+typedef pthread_t ccmd_thread;
+typedef pthread_mutex_t ccmd_mutex;
+typedef pthread_cond_t ccmd_condition;
+typedef void* ccmd_thread_return;
+#define CCMD_THREAD_CALL
+#endif // CPLATFORM_OS_WINDOWS == 1
 
-                if (nargs_parsed - option_args_begin < min_nargs)
-                {
-                    ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INVALID_NARGS, CCMD_ARGUMENT_OPTION_N_OR_MORE,
-                        option_info->short_name,
-                        option_info->long_name,
-                        min_nargs
-                    );
-                    return CCMD_STATUS_ERROR;
-                }
+typedef ccmd_thread_return(CCMD_THREAD_CALL *ccmd_thread_function)(void* user_data);
+
+static void ccmd_mutex_init(ccmd_mutex* mutex)
+{
+#if CPLATFORM_OS_WINDOWS == 1
+    InitializeSRWLock(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif // CPLATFORM_OS_WINDOWS == 1
+}
+
+static void ccmd_mutex_destroy(ccmd_mutex* mutex)
+{
+#if CPLATFORM_OS_WINDOWS == 1
+    CPLATFORM_UNUSED(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif // CPLATFORM_OS_WINDOWS == 1
+}
+
+static void ccmd_mutex_lock(ccmd_mutex* mutex)
+{
+#if CPLATFORM_OS_WINDOWS == 1
+    AcquireSRWLockExclusive(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif // CPLATFORM_OS_WINDOWS == 1
+}
+
+static void ccmd_mutex_unlock(ccmd_mutex* mutex)
+{
+#if CPLATFORM_OS_WINDOWS == 1
+    ReleaseSRWLockExclusive(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif // CPLATFORM_OS_WINDOWS == 1
+}
+
+static void ccmd_condition_init(ccmd_condition* condition)
+{
+#if CPLATFORM_OS_WINDOWS == 1
+    InitializeConditionVariable(condition);
+#else
+    pthread_cond_init(condition, NULL);
+#endif // CPLATFORM_OS_WINDOWS == 1
+}
+
+static void ccmd_condition_destroy(ccmd_condition* condition)
+{
+#if CPLATFORM_OS_WINDOWS == 1
+    CPLATFORM_UNUSED(condition);
+#else
+    pthread_cond_destroy(condition);
+#endif // CPLATFORM_OS_WINDOWS == 1
+}
+
+static void ccmd_condition_wait(ccmd_condition* condition, ccmd_mutex* mutex)
+{
+#if CPLATFORM_OS_WINDOWS == 1
+    SleepConditionVariableSRW(condition, mutex, INFINITE, 0);
+#else
+    pthread_cond_wait(condition, mutex);
+#endif // CPLATFORM_OS_WINDOWS == 1
+}
+
+static void ccmd_condition_broadcast(ccmd_condition* condition)
+{
+#if CPLATFORM_OS_WINDOWS == 1
+    WakeAllConditionVariable(condition);
+#else
+    pthread_cond_broadcast(condition);
+#endif // CPLATFORM_OS_WINDOWS == 1
+}
+
+static bool ccmd_thread_create(ccmd_thread* thread, ccmd_thread_function function, void* user_data)
+{
+#if CPLATFORM_OS_WINDOWS == 1
+    *thread = CreateThread(NULL, 0, function, user_data, 0, NULL);
+    return *thread != NULL;
+#else
+    return pthread_create(thread, NULL, function, user_data) == 0;
+#endif // CPLATFORM_OS_WINDOWS == 1
+}
+
+static void ccmd_thread_join(ccmd_thread thread)
+{
+#if CPLATFORM_OS_WINDOWS == 1
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif // CPLATFORM_OS_WINDOWS == 1
+}
+
+typedef void(*ccmd_parallel_function)(void* user_data, const int32_t begin, const int32_t end);
+
+struct ccmd_thread_pool
+{
+    ccmd_mutex                  mutex;
+    ccmd_condition              work_available;
+    ccmd_condition              work_finished;
+
+    // the current job - workers claim [next, next + grain) ranges until next reaches count
+    ccmd_parallel_function      function;
+    void*                       user_data;
+    int32_t                     count;
+    int32_t                     grain;
+    int32_t                     next;
+    int32_t                     active;
+    bool                        busy;
+    bool                        shutdown;
+
+    int32_t                     thread_count;
+    ccmd_thread*                threads;
+};
+
+// Claims and runs ranges of the current job until there are none left. The pool mutex must be held
+static void ccmd_thread_pool_run_ranges(ccmd_thread_pool* pool)
+{
+    while (pool->next < pool->count)
+    {
+        const int32_t begin = pool->next;
+        const int32_t end = CPLATFORM_MIN(begin + pool->grain, pool->count);
+        pool->next = end;
+        ++pool->active;
+
+        ccmd_mutex_unlock(&pool->mutex);
+        pool->function(pool->user_data, begin, end);
+        ccmd_mutex_lock(&pool->mutex);
+
+        --pool->active;
+        if (pool->next >= pool->count && pool->active == 0)
+        {
+            ccmd_condition_broadcast(&pool->work_finished);
+        }
+    }
+}
+
+static ccmd_thread_return CCMD_THREAD_CALL ccmd_thread_pool_worker(void* user_data)
+{
+    ccmd_thread_pool* pool = (ccmd_thread_pool*)user_data;
+
+    ccmd_mutex_lock(&pool->mutex);
+    while (!pool->shutdown)
+    {
+        if (pool->next >= pool->count)
+        {
+            ccmd_condition_wait(&pool->work_available, &pool->mutex);
+            continue;
+        }
+
+        ccmd_thread_pool_run_ranges(pool);
+    }
+    ccmd_mutex_unlock(&pool->mutex);
+
+    return 0;
+}
+
+// Calls `function` over [0, count) split into ranges of `grain` items across the pool and the calling thread
+static void ccmd_parallel_for(ccmd_thread_pool* pool, const int32_t count, const int32_t grain, ccmd_parallel_function function, void* user_data)
+{
+    if (pool == NULL || pool->thread_count <= 0 || count <= grain)
+    {
+        function(user_data, 0, count);
+        return;
+    }
+
+    ccmd_mutex_lock(&pool->mutex);
+
+    // only one job at a time
+    while (pool->busy)
+    {
+        ccmd_condition_wait(&pool->work_finished, &pool->mutex);
+    }
+
+    pool->busy = true;
+    pool->function = function;
+    pool->user_data = user_data;
+    pool->grain = grain;
+    pool->next = 0;
+    pool->active = 0;
+    pool->count = count;
+    ccmd_condition_broadcast(&pool->work_available);
+
+    // help out on the calling thread rather than just waiting
+    ccmd_thread_pool_run_ranges(pool);
+
+    while (pool->active > 0)
+    {
+        ccmd_condition_wait(&pool->work_finished, &pool->mutex);
+    }
+
+    pool->busy = false;
+    pool->count = 0;
+    pool->next = 0;
+    ccmd_condition_broadcast(&pool->work_finished);
+    ccmd_mutex_unlock(&pool->mutex);
+}
+
+/*
+ *****************************
+ *
+ * Batch parsing
+ *
+ *****************************
+ */
+#define CCMD_BATCH_GRAIN 256
+
+static size_t ccmd_batch_line_layout(const ccmd_command_line* line, const ccmd_compiled* compiled, ccmd_capacity* capacity)
+{
+    // the lines are all known up-front so size the options for the clusters they actually have
+    const int32_t options = ccmd_max_command_line_options(line->argc, line->argv);
+    *capacity = ccmd_capacity_for_argc(compiled->max_depth, compiled->max_command_errors, compiled->max_path_options, compiled->has_values, line->argc, options);
+
+    // option ids go last as they're the only thing with a smaller alignment
+    return sizeof(ccmd_command_result) * capacity->commands
+        + sizeof(ccmd_parsed_args) * capacity->options
+        + sizeof(ccmd_error) * capacity->errors
+        + sizeof(ccmd_value) * capacity->values
+        + CPLATFORM_ROUND_UP(sizeof(int32_t) * capacity->option_ids, sizeof(void*));
+}
+
+typedef struct ccmd_batch_job
+{
+    const ccmd_batch*       batch;
+    const ccmd_compiled*    compiled;
+} ccmd_batch_job;
+
+static void ccmd_parse_batch_range(void* user_data, const int32_t begin, const int32_t end)
+{
+    const ccmd_batch_job* job = (const ccmd_batch_job*)user_data;
+    const ccmd_command* cli = job->compiled->nodes[0].command;
+
+    // errors go into each result's slice of the arena so the context has no writers and is only parser scratch
+    ccmd_context context;
+    context.out.write = NULL;
+    context.err.write = NULL;
+
+    for (int32_t i = begin; i < end; ++i)
+    {
+        const ccmd_command_line* line = &job->batch->lines.data[i];
+        job->batch->statuses.data[i] = ccmd_parse_with_context(
+            &context, &job->batch->results.data[i], line->argc, line->argv, cli, job->compiled,
+            i > begin ? &job->batch->results.data[i - 1] : NULL, NULL, false
+        );
+    }
+}
+
+/*
+ *****************************
+ *
+ * Public API implementations
+ *
+ *****************************
+ */
+ccmd_status ccmd_parse(ccmd_result* result, const int32_t argc, char* const* argv, const ccmd_command* cli)
+{
+    return ccmd_parse_internal(result, argc, argv, cli, NULL, NULL, true);
+}
+
+ccmd_status ccmd_parse_compiled(ccmd_result* result, const int32_t argc, char* const* argv, const ccmd_compiled* compiled)
+{
+    assert(compiled != NULL);
+    return ccmd_parse_internal(result, argc, argv, compiled->nodes[0].command, compiled, NULL, true);
+}
+
+ccmd_status ccmd_parse_line(ccmd_result* result, char* buffer, const int32_t length, const ccmd_command* cli)
+{
+    // the line has no program name so the first argument is always the command's name
+    static char empty_name[] = "";
+    char* program_path = cli->name != NULL ? (char*)cli->name : empty_name;
+
+    char** args = NULL;
+    int32_t arg_count = 0;
+    char invalid_char = '\0';
+    ccmd_split_status split_status = CCMD_SPLIT_SUCCESS;
+
+    if (result->line_args.data != NULL && result->line_args.count > 0)
+    {
+        // split straight into the caller's array
+        args = result->line_args.data;
+        split_status = ccmd_split_line(buffer, length, args + 1, result->line_args.count - 1, &arg_count, &invalid_char);
+    }
+    else if (result->arena != NULL)
+    {
+        // count the arguments first to allocate exactly enough, then walk the packed arguments
+        split_status = ccmd_split_line(buffer, length, NULL, 0, &arg_count, &invalid_char);
+        args = (char**)ccmd_arena_alloc(result->arena, sizeof(char*) * (arg_count + 1));
+        if (args != NULL && split_status == CCMD_SPLIT_SUCCESS)
+        {
+            char* arg = buffer;
+            for (int32_t i = 1; i <= arg_count; ++i)
+            {
+                args[i] = arg;
+                arg += strlen(arg) + 1;
+            }
+        }
+    }
+
+    ccmd_error input_error = { 0 };
+    const bool has_input_error = args == NULL || split_status != CCMD_SPLIT_SUCCESS;
+    if (args == NULL || split_status == CCMD_SPLIT_TOO_MANY_ARGS)
+    {
+        input_error.key = CCMD_ERROR_KEY(CCMD_ERROR_CATEGORY_INTERNAL, CCMD_ARGUMENT_INVALID);
+        input_error.str = "too many arguments in the line - increase the size of `result->line_args` or assign `result->arena`";
+    }
+    else if (split_status == CCMD_SPLIT_INVALID_QUOTING)
+    {
+        input_error.key = CCMD_ERROR_KEY(CCMD_ERROR_CATEGORY_INVALID_QUOTING, CCMD_ARGUMENT_INVALID);
+        input_error.char8 = invalid_char;
+    }
+
+    if (has_input_error)
+    {
+        return ccmd_parse_internal(result, 1, &program_path, cli, NULL, &input_error, false);
+    }
+
+    args[0] = program_path;
+    return ccmd_parse_internal(result, arg_count + 1, args, cli, NULL, NULL, false);
+}
+
+ccmd_compiled* ccmd_compile(const ccmd_command* cli)
+{
+    ccmd_compiled layout = { 0 };
+    ccmd_compile_measure(cli, 0, 0, &layout);
+
+    // the whole index lives in a single allocation: header, nodes, choice tables, sorted names, trie nodes, all the
+    // hash table slots and then option tables
+    const size_t nodes_size = sizeof(ccmd_compiled_node) * layout.node_count;
+    const size_t choice_tables_size = sizeof(ccmd_hash_table) * layout.choice_table_count;
+    const size_t sorted_names_size = sizeof(ccmd_sorted_name) * layout.sorted_name_count * 2; // by name and by length
+    const size_t trie_nodes_size = sizeof(ccmd_trie_node) * layout.sorted_name_count * 2;
+    const size_t slots_size = sizeof(ccmd_hash_slot) * layout.slot_count;
+    const size_t size = sizeof(ccmd_compiled) + nodes_size + choice_tables_size + sorted_names_size + trie_nodes_size + slots_size + layout.option_tables_size;
+    char* memory = (char*)CCMD_MALLOC(size);
+    if (memory == NULL)
+    {
+        return NULL;
+    }
+
+    memset(memory, 0, size);
+    ccmd_compiled* compiled = (ccmd_compiled*)memory;
+    *compiled = layout;
+    compiled->nodes = (ccmd_compiled_node*)(memory + sizeof(ccmd_compiled));
+    compiled->slots = (ccmd_hash_slot*)(memory + sizeof(ccmd_compiled) + nodes_size + choice_tables_size + sorted_names_size + trie_nodes_size);
+
+    compiled->nodes[0].command = cli;
+    compiled->nodes[0].parent = -1;
+    compiled->nodes[0].depth = 0;
+
+    // lay the nodes out breadth-first so each command's subcommands are contiguous and can be indexed directly
+    ccmd_hash_slot* slot_cursor = compiled->slots;
+    ccmd_hash_table* choice_table_cursor = (ccmd_hash_table*)(memory + sizeof(ccmd_compiled) + nodes_size);
+    ccmd_sorted_name* sorted_name_cursor = (ccmd_sorted_name*)(memory + sizeof(ccmd_compiled) + nodes_size + choice_tables_size);
+    ccmd_trie_node* trie_node_cursor = (ccmd_trie_node*)(memory + sizeof(ccmd_compiled) + nodes_size + choice_tables_size + sorted_names_size);
+    char* option_table_cursor = (char*)(compiled->slots + layout.slot_count);
+    int32_t node_end = 1;
+    for (int32_t node_index = 0; node_index < node_end; ++node_index)
+    {
+        ccmd_compiled_node* node = &compiled->nodes[node_index];
+        const ccmd_command* command = node->command;
+
+        node->first_subcommand = node_end;
+        node->help_column = ccmd_help_column(command);
+        for (int i = 0; i < command->subcommands.count; ++i)
+        {
+            ccmd_compiled_node* subcommand = &compiled->nodes[node_end++];
+            subcommand->command = &command->subcommands.data[i];
+            subcommand->parent = node_index;
+            subcommand->depth = node->depth + 1;
+        }
+
+        // reuse the command's own option table if it already has one
+        node->options = command->option_table;
+        if (node->options == NULL)
+        {
+            const ccmd_option_table_layout table_layout = ccmd_option_table_get_layout(command);
+            node->options = ccmd_option_table_build(option_table_cursor, &table_layout, command);
+            option_table_cursor += table_layout.size;
+
+            if (node->options == NULL)
+            {
+                CCMD_FREE(memory);
+                return NULL;
+            }
+        }
+
+        ccmd_hash_table_init(&node->subcommands, &slot_cursor, command->subcommands.count);
+        for (int i = 0; i < command->subcommands.count; ++i)
+        {
+            ccmd_hash_table_insert(&node->subcommands, command->subcommands.data[i].name, i);
+        }
+
+        // sorted names for prefix searches when completing
+        ccmd_sorted_name* sorted_subcommands = sorted_name_cursor;
+        for (int i = 0; i < command->subcommands.count; ++i)
+        {
+            const char* name = command->subcommands.data[i].name;
+            *sorted_name_cursor++ = (ccmd_sorted_name) { .name = name, .index = i, .length = (int32_t)strlen(name) };
+        }
+        qsort(sorted_subcommands, command->subcommands.count, sizeof(ccmd_sorted_name), ccmd_qsort_sorted_name_comp);
+        node->sorted_subcommands = sorted_subcommands;
 
-                if (!is_n_or_more && nargs_parsed < max_nargs)
+        ccmd_sorted_name* sorted_options = sorted_name_cursor;
+        for (int i = 0; i < command->options.count; ++i)
+        {
+            if (command->options.data[i].long_name != NULL)
+            {
+                const char* name = command->options.data[i].long_name;
+                *sorted_name_cursor++ = (ccmd_sorted_name) { .name = name, .index = i, .length = (int32_t)strlen(name) };
+            }
+        }
+        node->sorted_option_count = (int32_t)(sorted_name_cursor - sorted_options);
+        qsort(sorted_options, node->sorted_option_count, sizeof(ccmd_sorted_name), ccmd_qsort_sorted_name_comp);
+        node->sorted_options = sorted_options;
+
+        // abbreviations are resolved through tries built from the same sorted names
+        node->option_trie = ccmd_trie_build(&trie_node_cursor, sorted_options, node->sorted_option_count);
+        node->subcommand_trie = ccmd_trie_build(&trie_node_cursor, sorted_subcommands, command->subcommands.count);
+
+        // and suggestions for unrecognized names only need to look at the ones with a similar length
+        ccmd_sorted_name* subcommands_by_length = sorted_name_cursor;
+        sorted_name_cursor += command->subcommands.count;
+        memcpy(subcommands_by_length, sorted_subcommands, sizeof(ccmd_sorted_name) * command->subcommands.count);
+        qsort(subcommands_by_length, command->subcommands.count, sizeof(ccmd_sorted_name), ccmd_qsort_name_length_comp);
+        node->subcommands_by_length = subcommands_by_length;
+
+        ccmd_sorted_name* options_by_length = sorted_name_cursor;
+        sorted_name_cursor += node->sorted_option_count;
+        memcpy(options_by_length, sorted_options, sizeof(ccmd_sorted_name) * node->sorted_option_count);
+        qsort(options_by_length, node->sorted_option_count, sizeof(ccmd_sorted_name), ccmd_qsort_name_length_comp);
+        node->options_by_length = options_by_length;
+
+        // choices are matched with a single hash lookup rather than comparing against each one in turn
+        if (ccmd_command_has_choices(command))
+        {
+            ccmd_hash_table* choices = choice_table_cursor;
+            choice_table_cursor += command->options.count;
+            for (int i = 0; i < command->options.count; ++i)
+            {
+                const ccmd_option* option = &command->options.data[i];
+                ccmd_hash_table_init(&choices[i], &slot_cursor, option->choices.count);
+                for (int c = 0; c < option->choices.count; ++c)
                 {
-                    ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_INVALID_NARGS, CCMD_ARGUMENT_OPTION,
-                        option_info->short_name,
-                        option_info->long_name,
-                        option_info->nargs
-                    );
-                    return CCMD_STATUS_ERROR;
+                    ccmd_hash_table_insert(&choices[i], option->choices.data[c], c);
                 }
+            }
+            node->choices = choices;
+        }
+    }
+
+    return compiled;
+}
+
+void ccmd_free_compiled(ccmd_compiled* compiled)
+{
+    if (compiled == NULL)
+    {
+        return;
+    }
+
+    for (int32_t i = 0; i < compiled->node_count; ++i)
+    {
+        CCMD_FREE(compiled->nodes[i].usage);
+        CCMD_FREE(compiled->nodes[i].help);
+    }
 
-                // option parse success - add a new parsed one
-                ccmd_parsed_args* option_result = add_option(parser);
-                option_result->long_name = option_info->long_name;
-                option_result->short_name = option_info->short_name;
-                option_result->nargs = nargs_parsed - option_args_begin;
-                option_result->args = option_info->nargs != 0 ? &(argv[option_args_begin]) : NULL;
-                break;
-            }
-            case CCMD_TOKEN_POSITIONAL:
-            {
+    CCMD_FREE(compiled);
+}
 
-                // just add this to the positional array
-                const int position = parser->command_result->positionals.count++;
-                if (parser->command_result->positionals.data == NULL)
-                {
-                    parser->command_result->positionals.data = argv_slice;
-                }
+ccmd_option_table* ccmd_create_option_table(const ccmd_command* command)
+{
+    const ccmd_option_table_layout layout = ccmd_option_table_get_layout(command);
+    void* memory = CCMD_MALLOC(layout.size);
+    if (memory == NULL)
+    {
+        return NULL;
+    }
 
-                // mark required positional as parsed
-                const char* positional_name = command_info->positionals.data[position].name;
-                ccmd_remove_error(parser->program_result, CCMD_ERROR_CATEGORY_MISSING_REQUIRED_ARGUMENT, CCMD_ARGUMENT_POSITIONAL, '\0', positional_name);
-                break;
-            }
-            case CCMD_TOKEN_SUBCOMMAND:
-            {
-                // if all the positionals have been parsed then this is either a subcommand or otherwise it's invalid
-                const ccmd_command* subcommand_info = NULL;
-                for (int i = 0; i < command_info->subcommands.count; ++i)
-                {
-                    if (strncmp(token.value, command_info->subcommands.data[i].name, token.length) == 0)
-                    {
-                        subcommand_info = &command_info->subcommands.data[i];
-                        break;
-                    }
-                }
+    ccmd_option_table* table = ccmd_option_table_build(memory, &layout, command);
+    if (table == NULL)
+    {
+        CCMD_FREE(memory);
+    }
+    return table;
+}
 
-                // invalid - no such command
-                if (subcommand_info == NULL)
-                {
-                    ccmd_add_error(parser->program_result, CCMD_ERROR_CATEGORY_UNRECOGNIZED_ARGUMENT, CCMD_ARGUMENT_SUBCOMMAND,
-                        '\0', token.value, 0
-                    );
-                }
+void ccmd_free_option_table(ccmd_option_table* table)
+{
+    CCMD_FREE(table);
+}
 
-                // ensure all required options were found before moving to a subparser
-                if (parser->program_result->error_count > 0)
-                {
-                    return CCMD_STATUS_ERROR;
-                }
+ccmd_multicall* ccmd_create_multicall(const ccmd_applet* applets, const int32_t applet_count)
+{
+    int32_t name_count = applet_count;
+    for (int32_t i = 0; i < applet_count; ++i)
+    {
+        name_count += applets[i].aliases.count;
+    }
 
-                // valid subcommand - recursively parse. Since positionals take precedence over subcommands this is fine
-                assert(parser->program_result->commands_count < parser->program_result->commands.count);
+    // the table and its slots share one allocation
+    const size_t slots_size = sizeof(ccmd_hash_slot) * ccmd_hash_table_capacity(name_count);
+    char* memory = (char*)CCMD_MALLOC(sizeof(ccmd_multicall) + slots_size);
+    if (memory == NULL)
+    {
+        return NULL;
+    }
 
-                // setup the parser for the next recursive subcommand parse call
-                parser->command_infos[parser->program_result->commands_count] = subcommand_info;
-                parser->command_result = &parser->program_result->commands.data[parser->program_result->commands_count];
-                ++parser->program_result->commands_count;
+    memset(memory, 0, sizeof(ccmd_multicall) + slots_size);
+    ccmd_multicall* multicall = (ccmd_multicall*)memory;
+    multicall->applet_count = applet_count;
+    multicall->applets = applets;
 
-                // parse the subcommand
-                const int subcommand_argc = argc - nargs_parsed;
-                char* const* subcommand_argv = argv + nargs_parsed;
-                return ccmd_parse_command(subcommand_argc, subcommand_argv, parser);
-            }
+    ccmd_hash_slot* slot_cursor = (ccmd_hash_slot*)(memory + sizeof(ccmd_multicall));
+    ccmd_hash_table_init(&multicall->names, &slot_cursor, name_count);
+    for (int32_t i = 0; i < applet_count; ++i)
+    {
+        ccmd_hash_table_insert(&multicall->names, applets[i].name, i);
+    }
+
+    // aliases go in after every real name so they can never shadow one
+    for (int32_t i = 0; i < applet_count; ++i)
+    {
+        for (int32_t alias = 0; alias < applets[i].aliases.count; ++alias)
+        {
+            ccmd_hash_table_insert(&multicall->names, applets[i].aliases.data[alias], i);
         }
     }
 
-    return parser->program_result->error_count > 0 ? CCMD_STATUS_ERROR : CCMD_STATUS_SUCCESS;
+    return multicall;
 }
 
-static int ccmd_count_subcommands(const ccmd_command* command)
+void ccmd_free_multicall(ccmd_multicall* multicall)
 {
-    int count = 1 + command->subcommands.count; // self
-    if (command->subcommands.count > 0)
+    CCMD_FREE(multicall);
+}
+
+ccmd_status ccmd_parse_multicall(ccmd_result* result, const int32_t argc, char* const* argv, const ccmd_multicall* multicall)
+{
+    assert(multicall != NULL);
+
+    // the name the binary was run as picks the applet, i.e. a `ls -> box` symlink runs the `ls` applet
+    int32_t applet = -1;
+    if (argc > 0)
     {
-        for (int i = 0; i < command->subcommands.count; ++i)
+        result->program_path = argv[0];
+        ccmd_extract_program_name(result);
+        applet = ccmd_find_applet(multicall, result->program_name);
+    }
+
+    // otherwise the binary was run directly as `box ls ...` so the applet is the first argument
+    int32_t applet_argc = argc;
+    char* const* applet_argv = argv;
+    if (applet < 0 && argc > 1)
+    {
+        applet = ccmd_find_applet(multicall, argv[1]);
+        if (applet >= 0)
         {
-            count += ccmd_count_subcommands(&command->subcommands.data[i]);
+            applet_argc = argc - 1;
+            applet_argv = argv + 1;
         }
     }
-    return count;
+
+    if (applet < 0)
+    {
+        static const ccmd_command unknown_applet = { 0 };
+        ccmd_error input_error = { 0 };
+        input_error.key = CCMD_ERROR_KEY(CCMD_ERROR_CATEGORY_UNRECOGNIZED_ARGUMENT, CCMD_ARGUMENT_APPLET);
+        input_error.str = argc > 1 ? argv[1] : result->program_name;
+        input_error.int32 = (int32_t)strlen(input_error.str);
+        return ccmd_parse_internal(result, CPLATFORM_MIN(argc, 1), argv, &unknown_applet, NULL, &input_error, false);
+    }
+
+    const ccmd_applet* entry = &multicall->applets[applet];
+    if (entry->compiled != NULL)
+    {
+        return ccmd_parse_internal(result, applet_argc, applet_argv, entry->compiled->nodes[0].command, entry->compiled, NULL, true);
+    }
+    return ccmd_parse_internal(result, applet_argc, applet_argv, entry->command, NULL, NULL, true);
 }
 
-/*
- *****************************
- *
- * Public API implementations
- *
- *****************************
- */
-ccmd_status ccmd_parse(ccmd_result* result, const int32_t argc, char* const* argv, const ccmd_command* cli)
+ccmd_thread_pool* ccmd_create_thread_pool(const int32_t thread_count)
 {
-    if (result->commands.data == NULL || result->commands.count <= 0)
+    const int32_t count = CPLATFORM_MAX(thread_count, 0);
+    ccmd_thread_pool* pool = (ccmd_thread_pool*)CCMD_MALLOC(sizeof(ccmd_thread_pool) + sizeof(ccmd_thread) * count);
+    if (pool == NULL)
     {
-        fprintf(stderr, "the `result->commands` array view is NULL or invalid. This must be assigned before calling ccmd_parse\n");
-        exit(1);
+        return NULL;
     }
 
-    if (result->options.data == NULL || result->options.count <= 0)
+    memset(pool, 0, sizeof(ccmd_thread_pool));
+    pool->threads = (ccmd_thread*)(pool + 1);
+    ccmd_mutex_init(&pool->mutex);
+    ccmd_condition_init(&pool->work_available);
+    ccmd_condition_init(&pool->work_finished);
+
+    for (; pool->thread_count < count; ++pool->thread_count)
     {
-        fprintf(stderr, "the `result->options` array view is NULL or invalid. This must be assigned before calling ccmd_parse\n");
-        exit(1);
+        if (!ccmd_thread_create(&pool->threads[pool->thread_count], ccmd_thread_pool_worker, pool))
+        {
+            break;
+        }
     }
 
-    // defaults for the result
-    memset(result->program_name, 0, CCMD_PROGRAM_NAME_MAX);
-    result->program_path = "";
-    result->program_command = NULL;
-    result->option_count = 0;
-    result->commands_count = 0;
-    result->error_count = 0;
+    return pool;
+}
 
-    int subcommand_argc = argc;
-    char* const* subcommand_argv = argv;
+void ccmd_free_thread_pool(ccmd_thread_pool* pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
 
-    // Check if empty args -- this should only occur with an adhoc command line, not one generated by the OS
-    if (argc > 0)
+    ccmd_mutex_lock(&pool->mutex);
+    pool->shutdown = true;
+    ccmd_condition_broadcast(&pool->work_available);
+    ccmd_mutex_unlock(&pool->mutex);
+
+    for (int32_t i = 0; i < pool->thread_count; ++i)
     {
-        assert(argv[0] != NULL);
+        ccmd_thread_join(pool->threads[i]);
+    }
 
-        // Otherwise it's a normal command line
-        result->program_path = argv[0];
+    ccmd_condition_destroy(&pool->work_finished);
+    ccmd_condition_destroy(&pool->work_available);
+    ccmd_mutex_destroy(&pool->mutex);
+    CCMD_FREE(pool);
+}
 
-        // adjust command args to skip program name
-        subcommand_argc = argc - 1;
-        subcommand_argv = argv + 1;
+size_t ccmd_batch_arena_size(const ccmd_command_line* lines, const int32_t line_count, const ccmd_compiled* compiled)
+{
+    size_t size = 0;
+    for (int32_t i = 0; i < line_count; ++i)
+    {
+        ccmd_capacity capacity;
+        size += ccmd_batch_line_layout(&lines[i], compiled, &capacity);
     }
+    return size;
+}
 
-    // use the explicitly-specified name if one was provided
-    if (result->program_path != NULL)
+ccmd_status ccmd_parse_batch(ccmd_batch* batch, const ccmd_compiled* compiled)
+{
+    if (compiled == NULL || batch->results.count < batch->lines.count || batch->statuses.count < batch->lines.count)
     {
-        // otherwise try and discover the program name from the program path if there are any args
-        const int program_path_len = (int)strlen(result->program_path);
+        return CCMD_STATUS_ERROR;
+    }
 
-        // get the filename from the program path (i.e. program.exe)
-        const char* exe_name = result->program_path;
-        for (int i = 0; i < program_path_len; ++i)
+    // carve up the arena between all the results before parsing so each line can be parsed independently
+    char* cursor = (char*)batch->arena;
+    const char* arena_end = cursor + batch->arena_size;
+    for (int32_t i = 0; i < batch->lines.count; ++i)
+    {
+        ccmd_capacity capacity;
+        const size_t size = ccmd_batch_line_layout(&batch->lines.data[i], compiled, &capacity);
+        if (size > (size_t)(arena_end - cursor))
         {
-            if (result->program_path[i] != CPLATFORM_PATH_SEPARATOR || i >= program_path_len - 1)
-            {
-                continue;
-            }
-
-            exe_name = &result->program_path[i + 1];
+            return CCMD_STATUS_ERROR;
         }
 
-        // assign the program name and then try and remove the extension if one exists
-CPLATFORM_PUSH_WARNING
-        CPLATFORM_DISABLE_WARNING_GCC(-Wstringop-overflow)
-        const int full_exe_name = CPLATFORM_MIN(strlen(exe_name), CCMD_PROGRAM_NAME_MAX);
-        strncpy(result->program_name, exe_name, full_exe_name);
-CPLATFORM_POP_WARNING
+        // the batch arena is carved up ahead of time so the results can't share a growable one between threads
+        ccmd_result* result = &batch->results.data[i];
+        result->arena = NULL;
+        result->commands.data = (ccmd_command_result*)cursor;
+        result->commands.count = capacity.commands;
+        cursor += sizeof(ccmd_command_result) * capacity.commands;
 
-        // get the length of the default program name up to the extension and remove it, i.e. program.exe -> program
-        // adjust the command line to exclude the program path
-        int last_dot = full_exe_name;
-        for (int i = 0; i < full_exe_name; ++i)
-        {
-            if (result->program_name[i] == '.')
-            {
-                last_dot = i;
-            }
-        }
+        result->options.data = (ccmd_parsed_args*)cursor;
+        result->options.count = capacity.options;
+        cursor += sizeof(ccmd_parsed_args) * capacity.options;
 
-        if (last_dot < CCMD_PROGRAM_NAME_MAX)
-        {
-            // zero-out the remaining path
-            memset(result->program_name + last_dot, 0, CCMD_PROGRAM_NAME_MAX - last_dot);
-        }
+        result->errors.data = (ccmd_error*)cursor;
+        result->errors.count = capacity.errors;
+        cursor += sizeof(ccmd_error) * capacity.errors;
+
+        result->values.data = (ccmd_value*)cursor;
+        result->values.count = capacity.values;
+        cursor += sizeof(ccmd_value) * capacity.values;
+
+        result->option_ids.data = (int32_t*)cursor;
+        result->option_ids.count = capacity.option_ids;
+        cursor += CPLATFORM_ROUND_UP(sizeof(int32_t) * capacity.option_ids, sizeof(void*));
     }
 
-    // Set default name for the program command, otherwise it will be assigned in the parse_command call if cli defines one
-    ccmd_command_result* program_command = &result->commands.data[0];
-    program_command->name = result->program_name;
-    result->program_command = program_command;
+    ccmd_batch_job job = { batch, compiled };
+    ccmd_parallel_for(batch->pool, batch->lines.count, CCMD_BATCH_GRAIN, ccmd_parse_batch_range, &job);
+    return CCMD_STATUS_SUCCESS;
+}
 
-    const int total_subcommand_count = ccmd_count_subcommands(cli);
-    const ccmd_command** parsed_commands = CPLATFORM_ALLOCA_ARRAY(const ccmd_command*, sizeof(const ccmd_command*) * total_subcommand_count);
-    parsed_commands[0] = cli;
+ccmd_capacity ccmd_required_capacity(const ccmd_command* cli, const int32_t argc, char* const* argv)
+{
+    ccmd_capacity capacity = { 0, 0, 0, 0, 0, 0 };
+    const ccmd_command** path = CPLATFORM_ALLOCA_ARRAY(const ccmd_command*, ccmd_count_subcommands(cli));
+    path[0] = cli;
 
-    ccmd_status status = CCMD_STATUS_COUNT;
-    if (result->errors.data == NULL)
+    int32_t max_depth = 0;
+    if (!ccmd_measure_capacity(path, 0, 0, &max_depth, &capacity))
     {
-        // default error handling
-        ccmd_error errors[64];
-        CCMD_ARRAY_VIEW_INPLACE(result->errors, errors);
+        return (ccmd_capacity) { 0, 0, 0, 0, 0, 0 };
+    }
 
-        status = ccmd_parse_command(subcommand_argc, subcommand_argv, &(ccmd_parser) {
-            .command_result = &result->commands.data[result->commands_count++],
-            .command_infos = parsed_commands,
-            .program_result = result,
-        });
+    const int32_t usage_bytes = capacity.usage_bytes;
+    const int32_t options = ccmd_max_command_line_options(argc, argv);
+    capacity = ccmd_capacity_for_argc(max_depth, capacity.errors, capacity.option_ids, capacity.values != 0, argc, options);
+    capacity.usage_bytes = usage_bytes;
+    return capacity;
+}
 
-        if (status == CCMD_STATUS_ERROR)
-        {
-            char error_string[4096];
-            ccmd_formatter formatter = { .buffer_capacity = CCMD_ARRAY_SIZE(error_string), .buffer = error_string };
-            ccmd_default_error_report(program_command->name, &formatter, result);
-            fprintf(stderr, "%s\n", error_string);
-        }
+ccmd_arena* ccmd_create_arena(const size_t block_size)
+{
+    ccmd_arena* arena = (ccmd_arena*)CCMD_MALLOC(sizeof(ccmd_arena));
+    if (arena == NULL)
+    {
+        return NULL;
     }
-    else
+
+    arena->block_size = block_size > 0 ? block_size : CCMD_ARENA_BLOCK_SIZE;
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->mapped_files = NULL;
+    return arena;
+}
+
+void ccmd_free_arena(ccmd_arena* arena)
+{
+    if (arena == NULL)
     {
-        status = ccmd_parse_command(subcommand_argc, subcommand_argv, &(ccmd_parser) {
-            .command_result = &result->commands.data[result->commands_count++],
-            .command_infos = parsed_commands,
-            .program_result = result
-        });
+        return;
+    }
+
+    ccmd_arena_unmap_files(arena);
+
+    ccmd_arena_block* block = arena->first;
+    while (block != NULL)
+    {
+        ccmd_arena_block* next = block->next;
+        CCMD_FREE(block);
+        block = next;
+    }
+
+    CCMD_FREE(arena);
+}
+
+void ccmd_reset_arena(ccmd_arena* arena)
+{
+    ccmd_arena_unmap_files(arena);
+    arena->current = arena->first;
+    if (arena->current != NULL)
+    {
+        arena->current->used = 0;
     }
+}
 
-    // just always generate the default program help even if help wasn't requested if a usage buffer is assigned
-    if (result->usage.data != NULL)
+const char* ccmd_get_usage(const ccmd_result* result)
+{
+    if (result->commands_count <= 0)
     {
-        ccmd_formatter formatter = { .buffer_capacity = result->usage.count, .buffer = result->usage.data };
-        ccmd_generate_usage(&formatter, result->commands_count, parsed_commands);
+        return NULL;
     }
-    else if (status == CCMD_STATUS_HELP)
+
+    const ccmd_command** commands = CPLATFORM_ALLOCA_ARRAY(const ccmd_command*, result->commands_count);
+    for (int32_t i = 0; i < result->commands_count; ++i)
     {
-        // otherwise do default usage handling if -h/--help were requested
-        char usage_buffer[4096];
-        ccmd_formatter formatter = { .buffer_capacity = CCMD_ARRAY_SIZE(usage_buffer), .buffer = usage_buffer };
-        ccmd_generate_usage(&formatter, result->commands_count, parsed_commands);
-        printf("%s\n", usage_buffer);
+        commands[i] = result->commands.data[i].info;
     }
 
-    return status;
+    if (result->compiled != NULL)
+    {
+        const ccmd_usage_cache* cached = ccmd_get_compiled_usage(result->compiled, commands, result->commands_count, 0);
+        return cached != NULL ? cached->text : NULL;
+    }
+
+    // nowhere to cache the text for an uncompiled spec so just render it into the usage buffer if there is one
+    if (result->usage.data == NULL || result->usage.count <= 0)
+    {
+        return NULL;
+    }
+
+    ccmd_formatter formatter = { .buffer_capacity = result->usage.count, .buffer = result->usage.data };
+    formatter.buffer[0] = '\0';
+    ccmd_generate_usage(&formatter, result->commands_count, commands, 0, 0);
+    return result->usage.data;
 }
 
 ccmd_status ccmd_run(const ccmd_result* program)
@@ -1302,6 +6232,143 @@ ccmd_status ccmd_run_all(const ccmd_result* program)
     return CCMD_STATUS_SUCCESS;
 }
 
+typedef enum ccmd_run_state
+{
+    CCMD_RUN_STATE_WAITING,
+    CCMD_RUN_STATE_RUNNING,
+    CCMD_RUN_STATE_FINISHED
+} ccmd_run_state;
+
+typedef struct ccmd_parallel_run
+{
+    const ccmd_result*  program;
+    ccmd_mutex          mutex;
+    ccmd_condition      finished;
+    ccmd_run_state*     states; // one per parsed command
+    int32_t             finished_count;
+    ccmd_status         status; // the first failure, if any
+} ccmd_parallel_run;
+
+// Whether the command at `index` has nothing left to wait for. Commands only ever wait on ones parsed before them so
+// the first unfinished command is always ready and the run can't deadlock
+static bool ccmd_run_ready(const ccmd_parallel_run* run, const int32_t index)
+{
+    const ccmd_command* info = run->program->commands.data[index].info;
+    switch (info != NULL ? info->run_order : CCMD_RUN_AFTER_PARENT)
+    {
+        case CCMD_RUN_INDEPENDENT:
+        {
+            return true;
+        }
+        case CCMD_RUN_AFTER_ALL:
+        {
+            for (int32_t i = 0; i < index; ++i)
+            {
+                if (run->states[i] != CCMD_RUN_STATE_FINISHED)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        default:
+        {
+            return index == 0 || run->states[index - 1] == CCMD_RUN_STATE_FINISHED;
+        }
+    }
+}
+
+// Every thread taking part picks up whichever command is ready next until they've all finished
+static void ccmd_run_worker(void* user_data, const int32_t begin, const int32_t end)
+{
+    CPLATFORM_UNUSED(begin);
+    CPLATFORM_UNUSED(end);
+
+    ccmd_parallel_run* run = (ccmd_parallel_run*)user_data;
+    const ccmd_command_result* commands = run->program->commands.data;
+    const int32_t count = run->program->commands_count;
+
+    ccmd_mutex_lock(&run->mutex);
+    while (run->finished_count < count)
+    {
+        int32_t next = -1;
+        for (int32_t i = 0; i < count && next < 0; ++i)
+        {
+            next = run->states[i] == CCMD_RUN_STATE_WAITING && ccmd_run_ready(run, i) ? i : -1;
+        }
+
+        if (next < 0)
+        {
+            ccmd_condition_wait(&run->finished, &run->mutex);
+            continue;
+        }
+
+        run->states[next] = CCMD_RUN_STATE_RUNNING;
+        ccmd_mutex_unlock(&run->mutex);
+        const ccmd_status status = commands[next].run(&commands[0], &commands[next]);
+        ccmd_mutex_lock(&run->mutex);
+
+        run->states[next] = CCMD_RUN_STATE_FINISHED;
+        ++run->finished_count;
+
+        // cancel everything that hasn't started - callbacks that are already running can't be stopped
+        if (status != CCMD_STATUS_SUCCESS && run->status == CCMD_STATUS_SUCCESS)
+        {
+            run->status = status;
+            for (int32_t i = 0; i < count; ++i)
+            {
+                if (run->states[i] == CCMD_RUN_STATE_WAITING)
+                {
+                    run->states[i] = CCMD_RUN_STATE_FINISHED;
+                    ++run->finished_count;
+                }
+            }
+        }
+
+        ccmd_condition_broadcast(&run->finished);
+    }
+    ccmd_mutex_unlock(&run->mutex);
+}
+
+ccmd_status ccmd_run_all_parallel(const ccmd_result* program, ccmd_thread_pool* pool)
+{
+    if (pool == NULL)
+    {
+        return ccmd_run_all(program);
+    }
+
+    ccmd_parallel_run run;
+    run.program = program;
+    run.states = CPLATFORM_ALLOCA_ARRAY(ccmd_run_state, program->commands_count);
+    run.finished_count = 0;
+    run.status = CCMD_STATUS_SUCCESS;
+
+    // commands without a callback have nothing to wait for
+    int32_t callbacks = 0;
+    for (int32_t i = 0; i < program->commands_count; ++i)
+    {
+        const bool has_run = program->commands.data[i].run != NULL;
+        run.states[i] = has_run ? CCMD_RUN_STATE_WAITING : CCMD_RUN_STATE_FINISHED;
+        run.finished_count += has_run ? 0 : 1;
+        callbacks += has_run ? 1 : 0;
+    }
+
+    if (callbacks <= 1)
+    {
+        return ccmd_run_all(program);
+    }
+
+    ccmd_mutex_init(&run.mutex);
+    ccmd_condition_init(&run.finished);
+
+    // there's never any use for more threads than callbacks
+    ccmd_parallel_for(pool, CPLATFORM_MIN(callbacks, pool->thread_count + 1), 1, ccmd_run_worker, &run);
+
+    ccmd_condition_destroy(&run.finished);
+    ccmd_mutex_destroy(&run.mutex);
+    return run.status;
+}
+
 bool ccmd_has_option(const ccmd_command_result* command, const char* long_or_short_name)
 {
     return ccmd_get_option(command, long_or_short_name) != NULL;
@@ -1311,6 +6378,15 @@ const ccmd_parsed_args* ccmd_get_option(const ccmd_command_result* command, cons
 {
     const int size = (int)strlen(long_or_short_name);
 
+    // resolve the id through the hashed tables if there are any
+    if (command->option_table != NULL)
+    {
+        const int id = size == 1
+            ? command->option_table->short_options[(uint8_t)*long_or_short_name]
+            : ccmd_option_table_find_long(command->option_table, long_or_short_name, size);
+        return id >= 0 ? ccmd_get_option_by_id(command, id) : NULL;
+    }
+
     if (size == 1)
     {
         // compare as short flag, i.e. -h
@@ -1337,6 +6413,36 @@ const ccmd_parsed_args* ccmd_get_option(const ccmd_command_result* command, cons
     return NULL;
 }
 
+bool ccmd_has_option_by_id(const ccmd_command_result* command, const int32_t id)
+{
+    return ccmd_get_option_by_id(command, id) != NULL;
+}
+
+const ccmd_parsed_args* ccmd_get_option_by_id(const ccmd_command_result* command, const int32_t id)
+{
+    if (command->option_ids != NULL)
+    {
+        if (id < 0 || command->info == NULL || id >= command->info->options.count)
+        {
+            return NULL;
+        }
+
+        const int32_t index = command->option_ids[id];
+        return index >= 0 ? &command->options.data[index] : NULL;
+    }
+
+    // no id table was assigned
+    for (int i = 0; i < command->options.count; ++i)
+    {
+        if (command->options.data[i].id == id)
+        {
+            return &command->options.data[i];
+        }
+    }
+
+    return NULL;
+}
+
 bool ccmd_has_positional(const ccmd_command_result* command, const int32_t position)
 {
     return ccmd_get_positional(command, position) != NULL;
@@ -1,4 +1,5 @@
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /*
@@ -36,6 +37,25 @@
     #define CCMD_ERROR_MAX 64
 #endif // CCMD_ERROR_MAX
 
+#ifndef CCMD_CONTEXT_BUFFER_SIZE
+    #define CCMD_CONTEXT_BUFFER_SIZE 4096
+#endif // CCMD_CONTEXT_BUFFER_SIZE
+
+// Most chunks gathered into a single flush of a writer - long strings are referenced directly instead of copied
+#ifndef CCMD_CONTEXT_CHUNK_MAX
+    #define CCMD_CONTEXT_CHUNK_MAX 256
+#endif // CCMD_CONTEXT_CHUNK_MAX
+
+// Hidden first argument that turns a parse into a completion request: `prog __complete <cword> <words...>`
+#ifndef CCMD_COMPLETE_COMMAND
+    #define CCMD_COMPLETE_COMMAND "__complete"
+#endif // CCMD_COMPLETE_COMMAND
+
+// Columns -h/--help output is wrapped to when the terminal width can't be detected
+#ifndef CCMD_HELP_DEFAULT_WIDTH
+    #define CCMD_HELP_DEFAULT_WIDTH 80
+#endif // CCMD_HELP_DEFAULT_WIDTH
+
 #define CCMD_0_OR_MORE INT32_MIN
 #define CCMD_N_OR_MORE(N) ((N) <= 0 ? CCMD_0_OR_MORE : (CCMD_0_OR_MORE + (N)))
 
@@ -47,23 +67,95 @@
 
 struct ccmd_result;
 struct ccmd_command_result;
+struct ccmd_command;
+
+// Opaque, immutable index built from a ccmd_command tree by ccmd_compile
+typedef struct ccmd_compiled ccmd_compiled;
+
+// Opaque, immutable option lookup tables for a single command built by ccmd_create_option_table
+typedef struct ccmd_option_table ccmd_option_table;
+
+// Opaque hash table of applet names built by ccmd_create_multicall
+typedef struct ccmd_multicall ccmd_multicall;
+
+// Opaque pool of worker threads used to split up batch parsing and run callbacks, see ccmd_create_thread_pool
+typedef struct ccmd_thread_pool ccmd_thread_pool;
+
+// Opaque growable allocator that parse results can be stored in, see ccmd_create_arena
+typedef struct ccmd_arena ccmd_arena;
 
 typedef enum ccmd_status
 {
     CCMD_STATUS_SUCCESS,
     CCMD_STATUS_ERROR,
     CCMD_STATUS_HELP,
+    CCMD_STATUS_COMPLETE,   // the command line was a completion request - candidates were written instead of parsing
     CCMD_STATUS_COUNT
 } ccmd_status;
 
+typedef enum ccmd_shell
+{
+    CCMD_SHELL_BASH,
+    CCMD_SHELL_ZSH,
+    CCMD_SHELL_FISH,
+    CCMD_SHELL_COUNT
+} ccmd_shell;
+
 typedef struct ccmd_error
 {
     uint32_t    key;
     int32_t     int32;
     char        char8;
     const char* str;
+    const char* value; // the argument that caused the error, if any
+    const struct ccmd_command* command; // command the argument was parsed for, if any
+    const char* suggestion; // closest option or subcommand name to an unrecognized one, if any are close enough
 } ccmd_error;
 
+// Type to convert an option's arguments to while parsing
+typedef enum ccmd_value_type
+{
+    CCMD_VALUE_STRING,      // not converted - only `args` is set
+    CCMD_VALUE_INT64,       // decimal or 0x prefixed hex
+    CCMD_VALUE_DOUBLE,
+    CCMD_VALUE_BOOL,        // true/false, yes/no, on/off or 1/0
+    CCMD_VALUE_SIZE,        // bytes with an optional unit i.e. 512, 4KB (1000) or 4K/4KiB (1024)
+    CCMD_VALUE_DURATION,    // nanoseconds from a sequence of numbers and units i.e. 250ms or 1h30m
+    CCMD_VALUE_COUNT
+} ccmd_value_type;
+
+typedef union ccmd_value
+{
+    int64_t     int64;
+    double      float64;
+    bool        boolean;
+    uint64_t    size;
+    int64_t     duration_ns;
+    int32_t     choice; // index into the option's `choices`
+} ccmd_value;
+
+// What to write into `ccmd_result::destination` each time an option is parsed
+typedef enum ccmd_action
+{
+    CCMD_ACTION_NONE,
+    CCMD_ACTION_STORE_TRUE,     // bool = true
+    CCMD_ACTION_STORE_FALSE,    // bool = false
+    CCMD_ACTION_COUNT,          // int32_t incremented once per occurrence i.e. -vvv
+    CCMD_ACTION_STORE_VALUE,    // the first argument - const char*, the value type's member of ccmd_value or int32_t choice
+    CCMD_ACTION_APPEND,         // every argument is appended to a ccmd_append_list
+    CCMD_ACTION_MAX
+} ccmd_action;
+
+// Destination for CCMD_ACTION_APPEND. Arguments are added to `values` if the option has a value type or choices and
+// `strings` otherwise. Both are caller-owned and hold up to `capacity` entries
+typedef struct ccmd_append_list
+{
+    int32_t         count;
+    int32_t         capacity;
+    const char**    strings;
+    ccmd_value*     values;
+} ccmd_append_list;
+
 typedef struct ccmd_positional
 {
     const char* name;
@@ -77,10 +169,30 @@ typedef struct ccmd_option
     const char* help;
     int32_t     nargs;
     bool        required;
+    ccmd_value_type value_type;
+
+    // optional - the only values each argument may take. Options with choices store the index of the matched choice
+    // in `values` instead of converting to `value_type`
+    CCMD_ARRAY_VIEW_TYPE(const char* const)
+    choices;
+
+    // optional - written into the result's `destination` at `offset` (i.e. offsetof(my_config, verbose)) as soon as the
+    // option is parsed
+    ccmd_action action;
+    size_t      offset;
 } ccmd_option;
 
 typedef ccmd_status(*ccmd_run_callback)(const struct ccmd_command_result* program, const struct ccmd_command_result* command);
 
+// When ccmd_run_all_parallel can start a command's run callback relative to the commands parsed before it
+typedef enum ccmd_run_order
+{
+    CCMD_RUN_AFTER_PARENT,      // once the command it's a subcommand of has finished - the default
+    CCMD_RUN_AFTER_ALL,         // once every command before it has finished, like ccmd_run_all
+    CCMD_RUN_INDEPENDENT,       // straight away - it doesn't need anything from the other commands
+    CCMD_RUN_ORDER_COUNT
+} ccmd_run_order;
+
 typedef struct ccmd_command
 {
     const char*             name;
@@ -96,19 +208,74 @@ typedef struct ccmd_command
     subcommands;
 
     ccmd_run_callback    run;
+
+    // optional - constant-time option lookup tables for this command, see ccmd_create_option_table
+    const ccmd_option_table* option_table;
+
+    // optional - what `run` has to wait for when it's called by ccmd_run_all_parallel
+    ccmd_run_order          run_order;
 } ccmd_command;
 
+typedef int32_t(*ccmd_write_callback)(void* user_data, const char* data, int32_t length);
+
+typedef struct ccmd_write_chunk
+{
+    const char*     data;
+    int32_t         length;
+} ccmd_write_chunk;
+
+typedef int32_t(*ccmd_write_chunks_callback)(void* user_data, const ccmd_write_chunk* chunks, int32_t count);
+
+// Output is buffered in `ccmd_context::buffer` and flushed whenever it fills up so usage and error messages of any
+// length are written in full
+typedef struct ccmd_writer
+{
+    ccmd_write_callback     write; // NULL discards all output
+    void*                   user_data;
+
+    // optional - writes every chunk of a flush in one call i.e. with writev. If NULL `write` is called per chunk
+    ccmd_write_chunks_callback  write_chunks;
+} ccmd_writer;
+
+// All the state ccmd_parse needs beyond the result itself. Assigning one to `ccmd_result::context` makes parsing
+// reentrant: nothing is written to stdout/stderr, the process is never exited and no large buffers are put on the
+// stack. Each thread needs its own context and result but they can all share the same ccmd_command tree
+typedef struct ccmd_context
+{
+    ccmd_writer     out;    // receives -h/--help usage text
+    ccmd_writer     err;    // receives error reports if `ccmd_result::errors` isn't assigned
+
+    // columns to wrap -h/--help output at. 0 uses $COLUMNS if it's set or else CCMD_HELP_DEFAULT_WIDTH. Negative
+    // never wraps. Text written into `ccmd_result::usage` is never wrapped
+    int32_t         help_width;
+    ccmd_error      errors[CCMD_ERROR_MAX];
+    char            buffer[CCMD_CONTEXT_BUFFER_SIZE];
+    ccmd_write_chunk chunks[CCMD_CONTEXT_CHUNK_MAX];
+} ccmd_context;
+
 typedef struct ccmd_parsed_args
 {
+    int32_t         id; // index of the option in its command's `options`
     char            short_name;
     const char*     long_name;
     char* const*    args;
+    // `args` converted to the option's value type or NULL if it has none or the result had no `values` or arena
+    const ccmd_value* values;
     int32_t         nargs;
+
+    // a value given in the same argument as the option (--name=value or -ovalue). `args` points here when it's set
+    char*           attached;
 } ccmd_parsed_args;
 
 typedef struct ccmd_command_result
 {
     const char*             name;
+    const ccmd_command*     info; // the spec this command was parsed from
+    const ccmd_option_table* option_table; // tables used to resolve option names, if the spec had any
+
+    // index into `options` of the first occurrence of each option id or -1 if it wasn't parsed. NULL if the result
+    // had no `option_ids` or arena assigned
+    const int32_t*          option_ids;
 
     CCMD_ARRAY_VIEW_TYPE(char* const)
     positionals;
@@ -118,16 +285,70 @@ typedef struct ccmd_command_result
     ccmd_run_callback        run;
 } ccmd_command_result;
 
+#if defined(CCMD_ENABLE_INSTRUMENTATION)
+typedef enum ccmd_phase
+{
+    CCMD_PHASE_TOKENIZE,    // response file expansion and argument classification
+    CCMD_PHASE_MATCH,       // matching options/subcommands and converting values
+    CCMD_PHASE_VALIDATE,    // checking for missing positionals and required options
+    CCMD_PHASE_FORMAT,      // formatting usage and error reports
+    CCMD_PHASE_COUNT
+} ccmd_phase;
+
+// Counters for where parse time goes. They're added to on every parse and never reset so they can be summed across
+// many parses and exported. Only available when built with CCMD_ENABLE_INSTRUMENTATION
+typedef struct ccmd_instrumentation
+{
+    int64_t     parses;
+    int64_t     tokens_classified;
+    int64_t     option_comparisons; // table lookups and name compares made while matching options
+    int64_t     subcommand_lookups;
+    int64_t     errors_added;
+    int64_t     errors_dropped;     // errors that didn't fit into `ccmd_result::errors`
+    int64_t     usage_bytes;
+    int64_t     error_bytes;
+    int64_t     phase_ns[CCMD_PHASE_COUNT];
+} ccmd_instrumentation;
+#endif // defined(CCMD_ENABLE_INSTRUMENTATION)
+
 typedef struct ccmd_result
 {
     char                            program_name[CCMD_PROGRAM_NAME_MAX];
     const char*                     program_path;
     const ccmd_command_result*      program_command;
+    const ccmd_compiled*            compiled; // the compiled spec used to parse the result, if any
     int32_t                         option_count;
     int32_t                         commands_count;
     int32_t                         error_count;
 
-    // buffers to redirect usage/error messages
+    // optional - if NULL output goes to stdout/stderr
+    ccmd_context*                   context;
+
+    // optional - expand GCC-style @file arguments with the arguments read from the file. Files are mapped into memory
+    // and split in place so `arena` must be assigned and the arguments are valid until it's reset. Nested @files are
+    // expanded as well and an @file that can't be read is kept as a regular argument
+    bool                            response_files;
+
+    // optional - answer `prog __complete <cword> <words...>` with the completions for the shell instead of parsing and
+    // return CCMD_STATUS_COMPLETE, see ccmd_generate_completion_script. Only ccmd_parse, ccmd_parse_compiled and
+    // ccmd_parse_multicall honour this - lines and batches are never treated as completion requests
+    bool                            completion;
+
+    // optional - if assigned, `options` and `commands` are allocated from the arena on every parse, sized for the
+    // command line, and the caller doesn't need to assign them. Reset the arena once the result is no longer needed
+    ccmd_arena*                     arena;
+
+    // optional - user struct that options with an action are written into while parsing. Fields are only written for
+    // options that appear on the command line so assign any defaults beforehand
+    void*                           destination;
+
+#if defined(CCMD_ENABLE_INSTRUMENTATION)
+    // optional - counters updated while parsing
+    ccmd_instrumentation*           instrumentation;
+#endif // defined(CCMD_ENABLE_INSTRUMENTATION)
+
+    // buffers to redirect usage/error messages. Usage is only written to the buffer if -h/--help was requested or
+    // via ccmd_get_usage
     CCMD_ARRAY_VIEW_TYPE(ccmd_error)
     errors;
 
@@ -139,8 +360,70 @@ typedef struct ccmd_result
 
     CCMD_ARRAY_VIEW_TYPE(ccmd_command_result)
     commands;
+
+    // optional - storage for the arguments split by ccmd_parse_line. The first entry is used for the program name. If
+    // NULL the arguments are allocated from `arena` instead
+    CCMD_ARRAY_VIEW_TYPE(char*)
+    line_args;
+
+    // optional - storage for converted option values, one per argument given to an option with a value type. Not
+    // used if `arena` is assigned - the values are allocated from it instead. If neither is assigned arguments are
+    // still checked against the value type and actions still get converted values but nothing else keeps them
+    CCMD_ARRAY_VIEW_TYPE(ccmd_value)
+    values;
+
+    // optional - storage for each command's id -> option table, one entry per option declared by a parsed command
+    CCMD_ARRAY_VIEW_TYPE(int32_t)
+    option_ids;
 } ccmd_result;
 
+// One tool in a multicall (busybox style) binary, selected when the binary is run as `name` or any of `aliases`
+typedef struct ccmd_applet
+{
+    const char*             name;
+    const ccmd_command*     command;
+    const ccmd_compiled*    compiled; // optional - if assigned the applet is parsed with this instead of `command`
+
+    CCMD_ARRAY_VIEW_TYPE(const char* const)
+    aliases;
+} ccmd_applet;
+
+typedef struct ccmd_command_line
+{
+    int32_t         argc;
+    char* const*    argv;
+} ccmd_command_line;
+
+// Exact worst-case sizes of the arrays in a ccmd_result for a spec and command line
+typedef struct ccmd_capacity
+{
+    int32_t         commands;
+    int32_t         options;
+    int32_t         errors;
+    int32_t         option_ids;
+    int32_t         values;
+    int32_t         usage_bytes; // longest usage message of any command, including the terminator
+} ccmd_capacity;
+
+typedef struct ccmd_batch
+{
+    CCMD_ARRAY_VIEW_TYPE(const ccmd_command_line)
+    lines;
+
+    // one result and status per line. The results' commands, options and errors views are assigned from `arena`
+    CCMD_ARRAY_VIEW_TYPE(ccmd_result)
+    results;
+    CCMD_ARRAY_VIEW_TYPE(ccmd_status)
+    statuses;
+
+    // backing storage for every result in the batch - must be at least ccmd_batch_arena_size bytes
+    void*               arena;
+    size_t              arena_size;
+
+    // optional - splits the batch between the pool's threads and the calling thread
+    ccmd_thread_pool*   pool;
+} ccmd_batch;
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -148,10 +431,87 @@ extern "C" {
 
 CCMD_API ccmd_status ccmd_parse(ccmd_result* result, const int32_t argc, char* const* argv, const ccmd_command* cli);
 
+// Splits `buffer` into arguments in place using POSIX shell quoting rules and parses them as if they followed the
+// program name on the command line. `buffer` is modified and must have room for a terminator at `buffer[length]`.
+// The arguments are stored in `result->line_args` or allocated from `result->arena` if that isn't assigned, so one of
+// them is required
+CCMD_API ccmd_status ccmd_parse_line(ccmd_result* result, char* buffer, const int32_t length, const ccmd_command* cli);
+
+// Builds a flat index of `cli` with hashed option/subcommand tables that can be shared between any number of
+// ccmd_parse_compiled calls. `cli` must outlive the returned index. Returns NULL if allocation fails
+CCMD_API ccmd_compiled* ccmd_compile(const ccmd_command* cli);
+
+CCMD_API void ccmd_free_compiled(ccmd_compiled* compiled);
+
+// Same as ccmd_parse but resolves options and subcommands through a compiled index
+CCMD_API ccmd_status ccmd_parse_compiled(ccmd_result* result, const int32_t argc, char* const* argv, const ccmd_compiled* compiled);
+
+// Builds a perfect hash table of the long option names and a direct table of the short option names for `command`.
+// Assign the result to `command->option_table` to use it from ccmd_parse - ccmd_compile builds these automatically
+// for any command without one. Returns NULL if allocation fails or the command has more than INT16_MAX options
+CCMD_API ccmd_option_table* ccmd_create_option_table(const ccmd_command* command);
+
+CCMD_API void ccmd_free_option_table(ccmd_option_table* table);
+
+// Hashes every applet name and alias so ccmd_parse_multicall dispatches in constant time. `applets` must outlive the
+// returned table. Returns NULL if allocation fails
+CCMD_API ccmd_multicall* ccmd_create_multicall(const ccmd_applet* applets, const int32_t applet_count);
+
+CCMD_API void ccmd_free_multicall(ccmd_multicall* multicall);
+
+// Parses with the applet named by the program name extracted from argv[0]. If that doesn't name one then argv[1] is
+// tried instead (i.e. `box ls -l`) and the rest of the command line is parsed as if the applet had been run directly.
+// Anything else is reported as an unrecognized applet
+CCMD_API ccmd_status ccmd_parse_multicall(ccmd_result* result, const int32_t argc, char* const* argv, const ccmd_multicall* multicall);
+
+// Creates `thread_count` worker threads - the thread that submits work to the pool always helps out as well
+CCMD_API ccmd_thread_pool* ccmd_create_thread_pool(const int32_t thread_count);
+
+CCMD_API void ccmd_free_thread_pool(ccmd_thread_pool* pool);
+
+// Returns the largest `commands`, `options`, `errors`, `option_ids`, `values` and `usage` views that parsing `argv`
+// with `cli` can use - `usage_bytes` is the size of the `usage` view. Sizing a result with these never runs out of
+// space. All zero if allocation fails while measuring the usage
+CCMD_API ccmd_capacity ccmd_required_capacity(const ccmd_command* cli, const int32_t argc, char* const* argv);
+
+// Creates a growable bump allocator for parse results. Memory is allocated in blocks of `block_size` bytes (or
+// CCMD_ARENA_BLOCK_SIZE if zero) which are kept and reused after a reset so parsing similarly sized command lines
+// doesn't allocate once the arena has warmed up
+CCMD_API ccmd_arena* ccmd_create_arena(const size_t block_size);
+
+CCMD_API void ccmd_free_arena(ccmd_arena* arena);
+
+// Invalidates every result allocated from the arena since the last reset
+CCMD_API void ccmd_reset_arena(ccmd_arena* arena);
+
+// Size in bytes of the arena needed to parse `lines` with ccmd_parse_batch
+CCMD_API size_t ccmd_batch_arena_size(const ccmd_command_line* lines, const int32_t line_count, const ccmd_compiled* compiled);
+
+// Parses every line in the batch without printing anything - each line's errors are stored in its result. Returns
+// CCMD_STATUS_ERROR only if the batch itself is invalid (i.e. the arena is too small), see `batch->statuses` for the
+// status of each line
+CCMD_API ccmd_status ccmd_parse_batch(ccmd_batch* batch, const ccmd_compiled* compiled);
+
+// Returns the usage text for the most recently parsed command in `result`. With a compiled spec the text is rendered
+// once per command path and cached in the ccmd_compiled until it's freed, otherwise it's rendered into
+// `result->usage` on every call (NULL if there is no usage buffer)
+CCMD_API const char* ccmd_get_usage(const ccmd_result* result);
+
+// Writes a script for `shell` that completes `program_name` by running `program_name __complete`, which ccmd_parse
+// answers from the spec before returning CCMD_STATUS_COMPLETE if `ccmd_result::completion` is set. Returns the
+// length of the whole script like snprintf so it was truncated if that's >= `buffer_size`
+CCMD_API int32_t ccmd_generate_completion_script(const ccmd_shell shell, const char* program_name, char* buffer, const int32_t buffer_size);
+
 CCMD_API ccmd_status ccmd_run(const ccmd_result* program);
 
 CCMD_API ccmd_status ccmd_run_all(const ccmd_result* program);
 
+// Like ccmd_run_all but callbacks whose `run_order` allows it run at the same time on `pool` and the calling thread.
+// The first callback to fail stops any that haven't started yet and its status is returned once the ones already
+// running have finished. Callbacks mustn't submit work to `pool` themselves. If `pool` is NULL the callbacks run in
+// order on the calling thread
+CCMD_API ccmd_status ccmd_run_all_parallel(const ccmd_result* program, ccmd_thread_pool* pool);
+
 CCMD_API bool ccmd_has_positional(const ccmd_command_result* command, const int32_t position);
 
 CCMD_API const char* ccmd_get_positional(const ccmd_command_result* command, const int32_t position);
@@ -160,6 +520,12 @@ CCMD_API bool ccmd_has_option(const ccmd_command_result* command, const char* lo
 
 CCMD_API const ccmd_parsed_args* ccmd_get_option(const ccmd_command_result* command, const char* long_or_short_name);
 
+// An option's id is its index in the command's `options` array. Constant time if the result had `option_ids` or an
+// arena assigned, otherwise scans the parsed options
+CCMD_API bool ccmd_has_option_by_id(const ccmd_command_result* command, const int32_t id);
+
+CCMD_API const ccmd_parsed_args* ccmd_get_option_by_id(const ccmd_command_result* command, const int32_t id);
+
 
 #ifdef __cplusplus
 }
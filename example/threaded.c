@@ -0,0 +1,171 @@
+/*
+ *  threaded.c
+ *  ccmd
+ *
+ *  Parses command lines on many threads at once against one shared ccmd_command tree. Each thread owns its own
+ *  ccmd_context and ccmd_result so the only thing shared is the read-only spec. Also registered as the `threaded` test -
+ *  configure with -DCCMD_ENABLE_TSAN=1 to check for data races.
+ *
+ *  Copyright (c) 2021 Jacob Milligan. All rights reserved.
+ */
+
+#include <ccmd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif // defined(_WIN32)
+
+#define THREAD_COUNT 8
+#define ITERATION_COUNT 2000
+
+typedef struct expected_parse
+{
+    int             argc;
+    char* const*    argv;
+    ccmd_status     status;
+    int32_t         commands_count;
+    int32_t         error_count;
+} expected_parse;
+
+typedef struct thread_data
+{
+    const ccmd_command*     cli;
+    const ccmd_compiled*    compiled;
+    int32_t                 bytes_written;
+    int32_t                 failures;
+} thread_data;
+
+static char* argv_success[] = { "program", "-v", "dump-files", "-i", "input", "-o", "a.txt", "b.txt" };
+static char* argv_missing[] = { "program", "dump-files" };
+static char* argv_help[] = { "program", "print-string", "-h" };
+static char* argv_unrecognized[] = { "program", "--bogus" };
+
+static const expected_parse expected[] = {
+    { CCMD_ARRAY_SIZE(argv_success), argv_success, CCMD_STATUS_SUCCESS, 2, 0 },
+    { CCMD_ARRAY_SIZE(argv_missing), argv_missing, CCMD_STATUS_ERROR, 2, 2 },
+    { CCMD_ARRAY_SIZE(argv_help), argv_help, CCMD_STATUS_HELP, 2, 0 },
+    { CCMD_ARRAY_SIZE(argv_unrecognized), argv_unrecognized, CCMD_STATUS_ERROR, 1, 1 },
+};
+
+static int32_t count_bytes(void* user_data, const char* data, const int32_t length)
+{
+    (void)data;
+    ((thread_data*)user_data)->bytes_written += length;
+    return length;
+}
+
+static void parse_many(thread_data* data)
+{
+    // everything the parser touches besides the spec is owned by this thread
+    ccmd_context context = {
+        .out = { .write = count_bytes, .user_data = data },
+        .err = { .write = count_bytes, .user_data = data }
+    };
+    ccmd_command_result commands[8];
+    ccmd_parsed_args options[16];
+    ccmd_result result = { .context = &context, .commands = CCMD_ARRAY_VIEW(commands), .options = CCMD_ARRAY_VIEW(options) };
+
+    for (int i = 0; i < ITERATION_COUNT; ++i)
+    {
+        const expected_parse* parse = &expected[i % CCMD_ARRAY_SIZE(expected)];
+        const ccmd_status status = i % 2 == 0
+            ? ccmd_parse(&result, parse->argc, parse->argv, data->cli)
+            : ccmd_parse_compiled(&result, parse->argc, parse->argv, data->compiled);
+
+        if (status != parse->status || result.commands_count != parse->commands_count || result.error_count != parse->error_count)
+        {
+            ++data->failures;
+        }
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI thread_main(LPVOID user_data)
+{
+    parse_many((thread_data*)user_data);
+    return 0;
+}
+#else
+static void* thread_main(void* user_data)
+{
+    parse_many((thread_data*)user_data);
+    return NULL;
+}
+#endif // defined(_WIN32)
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    const ccmd_command cli = {
+        .name = "program-name",
+        .help = "A program for doing things",
+        .options = CCMD_ARRAY_VIEW((ccmd_option[]) {
+            { .short_name = 'v', .long_name = "verbose", .help = "prints status of the commands", .nargs = 0, .required = false }
+        }),
+        .subcommands = CCMD_ARRAY_VIEW((ccmd_command[]) {
+            {
+                .name = "dump-files",
+                .help = "dumps input to a given set of absolute filepaths",
+                .options = CCMD_ARRAY_VIEW((ccmd_option[]){
+                    { .short_name = 'i', .long_name = "input", .help = "string to dump to the file/s", .nargs = 1, .required = true },
+                    { .short_name = 'o', .long_name = "output", .help = "file/s to dump to", .nargs = CCMD_N_OR_MORE(1), .required = true }
+                })
+            },
+            {
+                .name = "print-string",
+                .positionals = CCMD_ARRAY_VIEW((ccmd_positional[]) {
+                    { .name = "string", .help = "the string to print" }
+                })
+            }
+        })
+    };
+
+    ccmd_compiled* compiled = ccmd_compile(&cli);
+    thread_data data[THREAD_COUNT];
+
+#if defined(_WIN32)
+    HANDLE threads[THREAD_COUNT];
+    for (int i = 0; i < THREAD_COUNT; ++i)
+    {
+        data[i] = (thread_data) { .cli = &cli, .compiled = compiled };
+        threads[i] = CreateThread(NULL, 0, thread_main, &data[i], 0, NULL);
+    }
+    WaitForMultipleObjects(THREAD_COUNT, threads, TRUE, INFINITE);
+#else
+    pthread_t threads[THREAD_COUNT];
+    for (int i = 0; i < THREAD_COUNT; ++i)
+    {
+        data[i] = (thread_data) { .cli = &cli, .compiled = compiled };
+        pthread_create(&threads[i], NULL, thread_main, &data[i]);
+    }
+    for (int i = 0; i < THREAD_COUNT; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+#endif // defined(_WIN32)
+
+    int failures = 0;
+    for (int i = 0; i < THREAD_COUNT; ++i)
+    {
+        failures += data[i].failures;
+
+        // every thread parsed the same command lines so should have reported exactly the same output
+        if (data[i].bytes_written != data[0].bytes_written)
+        {
+            ++failures;
+        }
+    }
+
+    printf("%d threads x %d parses: %d failures\n", THREAD_COUNT, ITERATION_COUNT, failures);
+    ccmd_free_compiled(compiled);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
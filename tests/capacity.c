@@ -0,0 +1,362 @@
+/*
+ *  capacity.c
+ *  ccmd
+ *
+ *  Checks ccmd_required_capacity against random specs: every command line - valid or not - is parsed into views sized
+ *  exactly to the returned capacity and must never run out of space, and -h/--help must fit into `usage_bytes`
+ *
+ *  ccmd.c is compiled directly into this file so that internal errors can be told apart from user-facing ones
+ *
+ *  Copyright (c) 2021 Jacob Milligan. All rights reserved.
+ */
+
+#include "ccmd.c"
+
+#include <stdio.h>
+
+#define TEST_SPEC_COUNT 200
+#define TEST_LINES_PER_SPEC 200
+#define TEST_DEPTH_MAX 3
+#define TEST_SUBCOMMANDS_MAX 3
+#define TEST_OPTIONS_MAX 8
+#define TEST_POSITIONALS_MAX 3
+#define TEST_COMMANDS_MAX 64
+#define TEST_ARGS_MAX 48
+#define TEST_ARG_LENGTH_MAX 24
+#define TEST_USAGE_MAX (64 * 1024)
+
+typedef struct test_spec
+{
+    ccmd_command        commands[TEST_COMMANDS_MAX];
+    ccmd_command        subcommands[TEST_COMMANDS_MAX][TEST_SUBCOMMANDS_MAX];
+    ccmd_option         options[TEST_COMMANDS_MAX][TEST_OPTIONS_MAX];
+    ccmd_positional     positionals[TEST_COMMANDS_MAX][TEST_POSITIONALS_MAX];
+    char                long_names[TEST_COMMANDS_MAX][TEST_OPTIONS_MAX][8];
+    char                command_names[TEST_COMMANDS_MAX][TEST_SUBCOMMANDS_MAX][8];
+    int32_t             command_count;
+} test_spec;
+
+typedef struct test_line
+{
+    int32_t     argc;
+    char*       argv[TEST_ARGS_MAX];
+    char        storage[TEST_ARGS_MAX][TEST_ARG_LENGTH_MAX];
+} test_line;
+
+static const char* const test_choices[] = { "fast", "slow", "safe" };
+// no '--' as positionals on both sides of it need an arena
+static const char* const test_words[] = { "1", "-3", "0x1f", "true", "off", "fast", "slow", "nope", "2.5", "4KiB", "1h30m", "-", "" };
+
+static uint64_t test_random_state = 0x9e3779b97f4a7c15ull;
+
+static uint32_t test_random(const uint32_t range)
+{
+    // xorshift64* - deterministic across platforms unlike rand()
+    test_random_state ^= test_random_state >> 12;
+    test_random_state ^= test_random_state << 25;
+    test_random_state ^= test_random_state >> 27;
+    return (uint32_t)((test_random_state * 0x2545f4914f6cdd1dull) >> 32) % range;
+}
+
+static void test_random_name(char* name, const int32_t capacity)
+{
+    // a tiny alphabet makes prefixes, abbreviations and near-misses common
+    const int32_t length = 1 + (int32_t)test_random((uint32_t)capacity - 1);
+    for (int32_t i = 0; i < length; ++i)
+    {
+        name[i] = (char)('a' + test_random(4));
+    }
+    name[length] = '\0';
+}
+
+static bool test_name_taken(const ccmd_option* options, const int32_t count, const char* long_name, const char short_name)
+{
+    if (strcmp(long_name, "help") == 0 || short_name == 'h')
+    {
+        return true;
+    }
+    for (int32_t i = 0; i < count; ++i)
+    {
+        if (strcmp(options[i].long_name, long_name) == 0 || (short_name != '\0' && options[i].short_name == short_name))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void test_build_command(test_spec* spec, ccmd_command* command, const int32_t depth)
+{
+    const int32_t index = spec->command_count++;
+    ccmd_option* options = spec->options[index];
+    int32_t option_count = 0;
+    const int32_t option_target = (int32_t)test_random(TEST_OPTIONS_MAX + 1);
+    for (int32_t attempt = 0; attempt < 32 && option_count < option_target; ++attempt)
+    {
+        char* long_name = spec->long_names[index][option_count];
+        test_random_name(long_name, (int32_t)sizeof(spec->long_names[index][option_count]));
+        const char short_name = test_random(4) == 0 ? '\0' : (char)('a' + test_random(26));
+        if (test_name_taken(options, option_count, long_name, short_name))
+        {
+            continue;
+        }
+
+        static const int32_t nargs[] = { 0, 0, 1, 2, CCMD_0_OR_MORE, CCMD_N_OR_MORE(1) };
+        ccmd_option* option = &options[option_count++];
+        memset(option, 0, sizeof(ccmd_option));
+        option->short_name = short_name;
+        option->long_name = long_name;
+        option->help = test_random(2) == 0 ? "an option with a help string long enough to be wrapped onto more lines" : "opt";
+        option->nargs = nargs[test_random(CCMD_ARRAY_SIZE(nargs))];
+        option->required = test_random(5) == 0;
+        option->value_type = option->nargs != 0 ? (ccmd_value_type)test_random(CCMD_VALUE_COUNT) : CCMD_VALUE_STRING;
+        if (option->nargs != 0 && test_random(4) == 0)
+        {
+            option->choices.data = test_choices;
+            option->choices.count = CCMD_ARRAY_SIZE(test_choices);
+        }
+    }
+
+    const int32_t positional_count = (int32_t)test_random(TEST_POSITIONALS_MAX + 1);
+    for (int32_t i = 0; i < positional_count; ++i)
+    {
+        spec->positionals[index][i] = (ccmd_positional) { .name = "input", .help = "a positional" };
+    }
+
+    int32_t subcommand_count = 0;
+    if (depth + 1 < TEST_DEPTH_MAX)
+    {
+        const int32_t subcommand_target = (int32_t)test_random(TEST_SUBCOMMANDS_MAX + 1);
+        for (int32_t i = 0; i < subcommand_target; ++i)
+        {
+            char* name = spec->command_names[index][subcommand_count];
+            test_random_name(name, (int32_t)sizeof(spec->command_names[index][subcommand_count]));
+
+            bool taken = false;
+            for (int32_t j = 0; j < subcommand_count; ++j)
+            {
+                taken |= strcmp(spec->subcommands[index][j].name, name) == 0;
+            }
+            if (taken)
+            {
+                continue;
+            }
+
+            ccmd_command* subcommand = &spec->subcommands[index][subcommand_count++];
+            memset(subcommand, 0, sizeof(ccmd_command));
+            subcommand->name = name;
+            subcommand->help = "a subcommand";
+            test_build_command(spec, subcommand, depth + 1);
+        }
+    }
+
+    command->options.data = options;
+    command->options.count = option_count;
+    command->positionals.data = spec->positionals[index];
+    command->positionals.count = positional_count;
+    command->subcommands.data = spec->subcommands[index];
+    command->subcommands.count = subcommand_count;
+}
+
+static void test_push_arg(test_line* line, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line->storage[line->argc], TEST_ARG_LENGTH_MAX, format, args);
+    va_end(args);
+    line->argv[line->argc] = line->storage[line->argc];
+    ++line->argc;
+}
+
+static void test_build_line(test_line* line, const ccmd_command* cli)
+{
+    line->argc = 0;
+    test_push_arg(line, "prog");
+
+    const ccmd_command* command = cli;
+    while (line->argc < TEST_ARGS_MAX - 1)
+    {
+        const ccmd_option* options = command->options.data;
+        const int32_t option_count = command->options.count;
+        const ccmd_option* option = option_count > 0 ? &options[test_random((uint32_t)option_count)] : NULL;
+        const char* word = test_words[test_random(CCMD_ARRAY_SIZE(test_words))];
+
+        switch (test_random(12))
+        {
+            case 0:
+            {
+                // clusters longer than any fixed limit - repeated flags like -vvvvvvvvvvvv
+                char cluster[TEST_ARG_LENGTH_MAX];
+                int32_t length = 0;
+                cluster[length++] = '-';
+                const int32_t letters = 1 + (int32_t)test_random(TEST_ARG_LENGTH_MAX - 2);
+                for (int32_t i = 0; i < letters; ++i)
+                {
+                    const ccmd_option* letter = option_count > 0 ? &options[test_random((uint32_t)option_count)] : NULL;
+                    cluster[length++] = letter != NULL && letter->short_name != '\0' ? letter->short_name : 'z';
+                }
+                cluster[length] = '\0';
+                test_push_arg(line, "%s", cluster);
+                break;
+            }
+            case 1:
+            case 2:
+                if (option != NULL && option->short_name != '\0')
+                {
+                    test_push_arg(line, test_random(2) == 0 ? "-%c" : "-%c%s", option->short_name, word);
+                }
+                break;
+            case 3:
+            case 4:
+                if (option != NULL)
+                {
+                    test_push_arg(line, test_random(2) == 0 ? "--%s" : "--%s=%s", option->long_name, word);
+                }
+                break;
+            case 5:
+                // possibly an abbreviation
+                if (option != NULL)
+                {
+                    test_push_arg(line, "--%.*s", 1 + (int)test_random((uint32_t)strlen(option->long_name)), option->long_name);
+                }
+                break;
+            case 6:
+            case 7:
+                test_push_arg(line, "%s", word);
+                break;
+            case 8:
+                test_push_arg(line, test_random(2) == 0 ? "--bogus" : "-Q");
+                break;
+            case 9:
+                if (command->subcommands.count > 0)
+                {
+                    command = &command->subcommands.data[test_random((uint32_t)command->subcommands.count)];
+                    test_push_arg(line, "%s", command->name);
+                }
+                break;
+            case 10:
+                if (test_random(8) == 0)
+                {
+                    test_push_arg(line, test_random(2) == 0 ? "-h" : "--help");
+                }
+                break;
+            default:
+                return;
+        }
+    }
+}
+
+static char* test_alloc(const int32_t count, const size_t size)
+{
+    // never zero sized so an empty view still has a distinct pointer
+    return (char*)calloc((size_t)CPLATFORM_MAX(count, 1), size);
+}
+
+// Parses `line` into views sized exactly to `capacity`. Returns false if the parser ran out of space anywhere
+static bool test_parse_exact(const test_line* line, const ccmd_command* cli, const ccmd_compiled* compiled, const ccmd_capacity* capacity)
+{
+    test_line copy = *line;
+    for (int32_t i = 0; i < copy.argc; ++i)
+    {
+        copy.argv[i] = copy.storage[i];
+    }
+
+    ccmd_context context = { 0 };
+    ccmd_result result = { .context = &context };
+    result.commands.data = (ccmd_command_result*)test_alloc(capacity->commands, sizeof(ccmd_command_result));
+    result.commands.count = capacity->commands;
+    result.options.data = (ccmd_parsed_args*)test_alloc(capacity->options, sizeof(ccmd_parsed_args));
+    result.options.count = capacity->options;
+    result.errors.data = (ccmd_error*)test_alloc(capacity->errors, sizeof(ccmd_error));
+    result.errors.count = capacity->errors;
+    result.values.data = (ccmd_value*)test_alloc(capacity->values, sizeof(ccmd_value));
+    result.values.count = capacity->values;
+    result.option_ids.data = (int32_t*)test_alloc(capacity->option_ids, sizeof(int32_t));
+    result.option_ids.count = capacity->option_ids;
+    result.usage.data = test_alloc(capacity->usage_bytes, sizeof(char));
+    result.usage.count = capacity->usage_bytes;
+
+    const ccmd_status status = compiled != NULL
+        ? ccmd_parse_compiled(&result, copy.argc, copy.argv, compiled)
+        : ccmd_parse(&result, copy.argc, copy.argv, cli);
+
+    bool fits = true;
+    for (int32_t i = 0; i < result.error_count; ++i)
+    {
+        if (CCMD_ERROR_KEY_CATEGORY(result.errors.data[i].key) == CCMD_ERROR_CATEGORY_INTERNAL)
+        {
+            fprintf(stderr, "internal error: %s\n", result.errors.data[i].str);
+            fits = false;
+        }
+    }
+
+    if (status == CCMD_STATUS_HELP)
+    {
+        // the usage must be identical to one rendered without any size limit
+        static char unbounded[TEST_USAGE_MAX];
+        ccmd_formatter formatter = { .buffer_capacity = TEST_USAGE_MAX, .buffer = unbounded };
+        const ccmd_command* path[TEST_DEPTH_MAX];
+        for (int32_t i = 0; i < result.commands_count; ++i)
+        {
+            path[i] = result.commands.data[i].info;
+        }
+        ccmd_generate_usage(&formatter, result.commands_count, path, 0, 0);
+        if (strcmp(unbounded, result.usage.data) != 0)
+        {
+            fprintf(stderr, "usage truncated to %d bytes\n", capacity->usage_bytes);
+            fits = false;
+        }
+    }
+
+    free(result.commands.data);
+    free(result.options.data);
+    free(result.errors.data);
+    free(result.values.data);
+    free(result.option_ids.data);
+    free(result.usage.data);
+    return fits;
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    static test_spec spec;
+    static test_line line;
+    int32_t failures = 0;
+    int32_t parses = 0;
+
+    for (int32_t i = 0; i < TEST_SPEC_COUNT; ++i)
+    {
+        memset(&spec, 0, sizeof(spec));
+        ccmd_command cli = { .name = "prog", .help = "a randomly generated program" };
+        test_build_command(&spec, &cli, 0);
+        ccmd_compiled* compiled = ccmd_compile(&cli);
+
+        for (int32_t j = 0; j < TEST_LINES_PER_SPEC; ++j)
+        {
+            test_build_line(&line, &cli);
+            const ccmd_capacity capacity = ccmd_required_capacity(&cli, line.argc, line.argv);
+            for (int32_t k = 0; k < 2; ++k)
+            {
+                ++parses;
+                if (!test_parse_exact(&line, &cli, k == 0 ? NULL : compiled, &capacity))
+                {
+                    ++failures;
+                    fprintf(stderr, "spec %d line %d (%s):", i, j, k == 0 ? "ccmd_parse" : "ccmd_parse_compiled");
+                    for (int32_t arg = 0; arg < line.argc; ++arg)
+                    {
+                        fprintf(stderr, " '%s'", line.argv[arg]);
+                    }
+                    fprintf(stderr, "\n");
+                }
+            }
+        }
+
+        ccmd_free_compiled(compiled);
+    }
+
+    printf("%d parses sized with ccmd_required_capacity: %d failures\n", parses, failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
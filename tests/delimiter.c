@@ -0,0 +1,100 @@
+/*
+ *  delimiter.c
+ *  ccmd
+ *
+ *  Checks that every argument after `--` is parsed as a positional of the current command, even if it starts with a
+ *  dash
+ *
+ *  Copyright (c) 2021 Jacob Milligan. All rights reserved.
+ */
+
+#include <ccmd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(CONDITION) do { if (!(CONDITION)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #CONDITION); ++failures; } } while (0)
+
+static const ccmd_option options[] = {
+    { .short_name = 'v', .long_name = "verbose", .help = "prints status of the commands", .nargs = 0 },
+};
+
+static const ccmd_positional positionals[] = {
+    { .name = "in", .help = "file to read" },
+    { .name = "out", .help = "file to write" },
+};
+
+static const ccmd_command cli = {
+    .name = "prog",
+    .help = "a program with positionals that can start with a dash",
+    .positionals = CCMD_ARRAY_VIEW(positionals),
+    .options = CCMD_ARRAY_VIEW(options),
+};
+
+static ccmd_status parse(ccmd_result* result, ccmd_context* context, ccmd_arena* arena, const int argc, char** argv)
+{
+    static ccmd_command_result commands[4];
+    static ccmd_parsed_args parsed[8];
+    static ccmd_error errors[8];
+
+    memset(result, 0, sizeof(ccmd_result));
+    result->context = context;
+    result->arena = arena;
+    CCMD_ARRAY_VIEW_INPLACE(result->commands, commands);
+    CCMD_ARRAY_VIEW_INPLACE(result->options, parsed);
+    CCMD_ARRAY_VIEW_INPLACE(result->errors, errors);
+    return ccmd_parse(result, argc, argv, &cli);
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    ccmd_context context = { 0 };
+    ccmd_result result;
+
+    // dashed arguments after '--' fill the positionals instead of being parsed as options
+    {
+        char* args[] = { "prog", "--", "-v", "--out" };
+        CHECK(parse(&result, &context, NULL, CCMD_ARRAY_SIZE(args), args) == CCMD_STATUS_SUCCESS);
+        CHECK(!ccmd_has_option(result.program_command, "verbose"));
+        CHECK(ccmd_has_positional(result.program_command, 1));
+        CHECK(strcmp(ccmd_get_positional(result.program_command, 0), "-v") == 0);
+        CHECK(strcmp(ccmd_get_positional(result.program_command, 1), "--out") == 0);
+    }
+
+    // options before '--' are still options
+    {
+        char* args[] = { "prog", "-v", "--", "-file", "-" };
+        CHECK(parse(&result, &context, NULL, CCMD_ARRAY_SIZE(args), args) == CCMD_STATUS_SUCCESS);
+        CHECK(ccmd_has_option(result.program_command, "verbose"));
+        CHECK(strcmp(ccmd_get_positional(result.program_command, 0), "-file") == 0);
+        CHECK(strcmp(ccmd_get_positional(result.program_command, 1), "-") == 0);
+    }
+
+    // missing positionals are reported the same as without '--'
+    {
+        char* args[] = { "prog", "--", "-file" };
+        CHECK(parse(&result, &context, NULL, CCMD_ARRAY_SIZE(args), args) == CCMD_STATUS_ERROR);
+        CHECK(result.error_count == 1);
+    }
+
+    // positionals on both sides of '--' are copied together into the arena
+    {
+        char* args[] = { "prog", "in.txt", "--", "-out.txt" };
+        CHECK(parse(&result, &context, NULL, CCMD_ARRAY_SIZE(args), args) == CCMD_STATUS_ERROR);
+
+        ccmd_arena* arena = ccmd_create_arena(0);
+        CHECK(parse(&result, &context, arena, CCMD_ARRAY_SIZE(args), args) == CCMD_STATUS_SUCCESS);
+        CHECK(strcmp(ccmd_get_positional(result.program_command, 0), "in.txt") == 0);
+        CHECK(strcmp(ccmd_get_positional(result.program_command, 1), "-out.txt") == 0);
+        ccmd_free_arena(arena);
+    }
+
+    printf("delimiter: %d failures\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,159 @@
+/*
+ *  split_line.c
+ *  ccmd
+ *
+ *  Checks the line splitting used by ccmd_parse_line against the output of Python's shlex.split in POSIX mode, plus
+ *  the few escapes inside double quotes where shlex doesn't follow the POSIX shell. Empty quoted arguments must parse
+ *  like any other argument
+ *
+ *  ccmd.c is compiled directly into this file so that the splitter can be tested on its own
+ *
+ *  Copyright (c) 2021 Jacob Milligan. All rights reserved.
+ */
+
+#include "ccmd.c"
+
+#include <stdio.h>
+
+#define TEST_ARGS_MAX 8
+#define TEST_LINE_MAX 128
+
+typedef struct test_split
+{
+    const char*         line;
+    ccmd_split_status   status;
+    int32_t             count;
+    const char*         args[TEST_ARGS_MAX];
+} test_split;
+
+// the expected arguments are exactly what shlex.split returns for each line
+static const test_split shlex_cases[] = {
+    { "a b  c", CCMD_SPLIT_SUCCESS, 3, { "a", "b", "c" } },
+    { "  leading and trailing  ", CCMD_SPLIT_SUCCESS, 3, { "leading", "and", "trailing" } },
+    { "tab\tseparated\targs", CCMD_SPLIT_SUCCESS, 3, { "tab", "separated", "args" } },
+    { "'single quoted' arg", CCMD_SPLIT_SUCCESS, 2, { "single quoted", "arg" } },
+    { "\"double quoted\" arg", CCMD_SPLIT_SUCCESS, 2, { "double quoted", "arg" } },
+    { "''", CCMD_SPLIT_SUCCESS, 1, { "" } },
+    { "\"\"", CCMD_SPLIT_SUCCESS, 1, { "" } },
+    { "a '' b", CCMD_SPLIT_SUCCESS, 3, { "a", "", "b" } },
+    { "a \"\" b", CCMD_SPLIT_SUCCESS, 3, { "a", "", "b" } },
+    { "it\\'s fine", CCMD_SPLIT_SUCCESS, 2, { "it's", "fine" } },
+    { "'a'\"b\"c", CCMD_SPLIT_SUCCESS, 1, { "abc" } },
+    { "\"nested 'single'\"", CCMD_SPLIT_SUCCESS, 1, { "nested 'single'" } },
+    { "'nested \"double\"'", CCMD_SPLIT_SUCCESS, 1, { "nested \"double\"" } },
+    { "\"escaped \\\" quote\"", CCMD_SPLIT_SUCCESS, 1, { "escaped \" quote" } },
+    { "\"back\\\\slash\"", CCMD_SPLIT_SUCCESS, 1, { "back\\slash" } },
+    { "'back\\slash'", CCMD_SPLIT_SUCCESS, 1, { "back\\slash" } },
+    { "not\\ split", CCMD_SPLIT_SUCCESS, 1, { "not split" } },
+    { "\\\\", CCMD_SPLIT_SUCCESS, 1, { "\\" } },
+    { "\"keeps \\n backslash\"", CCMD_SPLIT_SUCCESS, 1, { "keeps \\n backslash" } },
+    { "--name='quoted value' -o\"x y\"", CCMD_SPLIT_SUCCESS, 2, { "--name=quoted value", "-ox y" } },
+    { "'open", CCMD_SPLIT_INVALID_QUOTING, 0, { NULL } },
+    { "\"open", CCMD_SPLIT_INVALID_QUOTING, 0, { NULL } },
+    { "trailing\\", CCMD_SPLIT_INVALID_QUOTING, 0, { NULL } },
+};
+
+// shlex keeps the backslash before $ and ` inside double quotes and doesn't join line continuations
+static const test_split posix_cases[] = {
+    { "\"\\$HOME\" \"\\`cmd\\`\"", CCMD_SPLIT_SUCCESS, 2, { "$HOME", "`cmd`" } },
+    { "con\\\ntinued", CCMD_SPLIT_SUCCESS, 1, { "continued" } },
+    { "\"con\\\ntinued\"", CCMD_SPLIT_SUCCESS, 1, { "continued" } },
+    { "a \\\n b", CCMD_SPLIT_SUCCESS, 2, { "a", "b" } },
+};
+
+static int32_t test_cases(const test_split* cases, const int32_t case_count)
+{
+    int32_t failures = 0;
+    for (int32_t i = 0; i < case_count; ++i)
+    {
+        char buffer[TEST_LINE_MAX];
+        char* args[TEST_ARGS_MAX];
+        const int32_t length = (int32_t)strlen(cases[i].line);
+        memcpy(buffer, cases[i].line, length + 1);
+
+        int32_t count = 0;
+        char invalid_char = '\0';
+        const ccmd_split_status status = ccmd_split_line(buffer, length, args, TEST_ARGS_MAX, &count, &invalid_char);
+
+        bool matches = status == cases[i].status && (status != CCMD_SPLIT_SUCCESS || count == cases[i].count);
+        for (int32_t arg = 0; matches && status == CCMD_SPLIT_SUCCESS && arg < count; ++arg)
+        {
+            matches = strcmp(args[arg], cases[i].args[arg]) == 0;
+        }
+
+        if (!matches)
+        {
+            printf("split mismatch: %s\n", cases[i].line);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+static int32_t test_empty_arguments(void)
+{
+    const ccmd_option options[] = {
+        { .short_name = 'o', .long_name = "output", .help = "file to write", .nargs = 1 },
+    };
+    const ccmd_positional positionals[] = {
+        { .name = "first", .help = "the first argument" },
+        { .name = "second", .help = "the second argument" },
+    };
+    const ccmd_command cli = {
+        .name = "prog",
+        .positionals = CCMD_ARRAY_VIEW(positionals),
+        .options = CCMD_ARRAY_VIEW(options),
+        .subcommands = CCMD_ARRAY_VIEW((ccmd_command[]) { { .name = "only" } }),
+    };
+
+    ccmd_context context = { 0 };
+    ccmd_command_result commands[4];
+    ccmd_parsed_args parsed[4];
+    ccmd_error errors[4];
+    char* line_args[8];
+    ccmd_result result = {
+        .context = &context,
+        .commands = CCMD_ARRAY_VIEW(commands),
+        .options = CCMD_ARRAY_VIEW(parsed),
+        .errors = CCMD_ARRAY_VIEW(errors),
+        .line_args = CCMD_ARRAY_VIEW(line_args),
+    };
+
+    int32_t failures = 0;
+
+    // empty positionals and option values
+    char line[] = "'' -o \"\" x";
+    if (ccmd_parse_line(&result, line, (int32_t)strlen(line), &cli) != CCMD_STATUS_SUCCESS
+        || strcmp(ccmd_get_positional(result.program_command, 0), "") != 0
+        || strcmp(ccmd_get_option(result.program_command, "output")->args[0], "") != 0)
+    {
+        printf("empty arguments weren't parsed as a positional and an option value\n");
+        ++failures;
+    }
+
+    // an empty argument where a subcommand is expected doesn't abbreviate the only one there is
+    char subcommand_line[] = "a b ''";
+    if (ccmd_parse_line(&result, subcommand_line, (int32_t)strlen(subcommand_line), &cli) != CCMD_STATUS_ERROR
+        || result.error_count != 1
+        || CCMD_ERROR_KEY_CATEGORY(result.errors.data[0].key) != CCMD_ERROR_CATEGORY_UNRECOGNIZED_ARGUMENT)
+    {
+        printf("an empty subcommand wasn't reported as unrecognized\n");
+        ++failures;
+    }
+
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    int32_t failures = 0;
+    failures += test_cases(shlex_cases, CCMD_ARRAY_SIZE(shlex_cases));
+    failures += test_cases(posix_cases, CCMD_ARRAY_SIZE(posix_cases));
+    failures += test_empty_arguments();
+
+    printf("split_line: %d failures\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,310 @@
+/*
+ *  values.c
+ *  ccmd
+ *
+ *  Checks the conversions used for options with a value type - the int64, size, duration and double parsers at the
+ *  edges of their ranges and where the result has to be rounded - and that typed options still parse when the result
+ *  has nowhere to keep the converted values
+ *
+ *  ccmd.c is compiled directly into this file so that the parsers can be tested on their own
+ *
+ *  Copyright (c) 2021 Jacob Milligan. All rights reserved.
+ */
+
+#include "ccmd.c"
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define TEST_RANDOM_DOUBLES 50000
+
+typedef struct test_int64
+{
+    const char* str;
+    bool        valid;
+    int64_t     value;
+} test_int64;
+
+typedef struct test_size
+{
+    const char* str;
+    bool        valid;
+    uint64_t    value;
+} test_size;
+
+typedef struct test_double
+{
+    const char* str;
+    bool        valid;
+    double      value;
+} test_double;
+
+static const test_int64 int64_cases[] = {
+    { "0", true, 0 },
+    { "-42", true, -42 },
+    { "+42", true, 42 },
+    { "0x1f", true, 31 },
+    { "-0X7fffffffffffffff", true, -INT64_MAX },
+    { "9223372036854775807", true, INT64_MAX },
+    { "-9223372036854775808", true, INT64_MIN },
+    { "9223372036854775808", false, 0 },
+    { "-9223372036854775809", false, 0 },
+    { "0x8000000000000000", false, 0 },
+    { "18446744073709551616", false, 0 },
+    { "99999999999999999999999", false, 0 },
+    { "", false, 0 },
+    { "-", false, 0 },
+    { "0x", false, 0 },
+    { "12a", false, 0 },
+    { "1.5", false, 0 },
+};
+
+static const test_size size_cases[] = {
+    { "512", true, 512 },
+    { "4KB", true, 4000 },
+    { "4K", true, 4096 },
+    { "4kib", true, 4096 },
+    { "1.5MiB", true, 1572864 },
+    { "0.001KB", true, 1 },             // exact, not 0.999... rounded down
+    { "0.1KiB", true, 102 },            // 102.4 bytes rounds down
+    { "0.3kb", true, 300 },
+    { "15EiB", true, UINT64_C(15) << 60 },
+    { "15.999999999999999999EiB", true, UINT64_C(18446744073709551614) },
+    { "18446744073709551615", true, UINT64_MAX },
+    { "18446744073709551616", false, 0 },
+    { "16EiB", false, 0 },
+    { "18446744073709551.616KB", false, 0 },
+    { "4XB", false, 0 },
+    { "KB", false, 0 },
+    { "-1", false, 0 },
+};
+
+static const test_int64 duration_cases[] = {
+    { "0", true, 0 },
+    { "250ms", true, INT64_C(250000000) },
+    { "1h30m", true, INT64_C(5400000000000) },
+    { "-1.5s", true, INT64_C(-1500000000) },
+    { "1us", true, 1000 },
+    { "1\xc2\xb5s", true, 1000 },
+    { "0.000000001s", true, 1 },
+    { "1.000000001s", true, INT64_C(1000000001) },
+    { "0.0000000015s", true, 1 },       // fractions of a nanosecond round down
+    { "1.1h", true, INT64_C(3960000000000) },
+    { "9223372036.854775807s", true, INT64_MAX },
+    { "-9223372036.854775808s", true, INT64_MIN },
+    { "106751d23h47m16.854775807s", true, INT64_MAX },
+    { "9223372036.854775808s", false, 0 },
+    { "106751d23h47m16.854775808s", false, 0 },
+    { "213503982d", false, 0 },
+    { "18446744073709551616ns", false, 0 },
+    { "5", false, 0 },
+    { "5x", false, 0 },
+    { "", false, 0 },
+};
+
+static const test_double double_cases[] = {
+    { "0", true, 0.0 },
+    { "-0", true, -0.0 },
+    { "1.5", true, 1.5 },
+    { ".5", true, 0.5 },
+    { "5.", true, 5.0 },
+    { "1e3", true, 1000.0 },
+    { "-2.5E-3", true, -0.0025 },
+    { "0.1", true, 0.1 },
+    { "0.30000000000000004", true, 0.30000000000000004 },
+    { "1e23", true, 1e23 },
+    { "9007199254740993", true, 9007199254740992.0 },                // halfway, ties to even
+    { "9007199254740995", true, 9007199254740996.0 },                // halfway, ties to even
+    { "9007199254740993.000000000000000000000000000001", true, 9007199254740994.0 },
+    { "123456789012345678901234567890", true, 1.2345678901234568e+29 },
+    { "2.2250738585072011e-308", true, 2.2250738585072009e-308 },   // largest subnormal
+    { "2.2250738585072014e-308", true, 2.2250738585072014e-308 },   // smallest normal
+    { "4.9406564584124654e-324", true, 4.9406564584124654e-324 },   // smallest subnormal
+    { "2.4703282292062327e-324", true, 0.0 },                        // just under half of it
+    { "2.4703282292062328e-324", true, 4.9406564584124654e-324 },   // just over half of it
+    { "1e-400", true, 0.0 },
+    { "1.7976931348623157e308", true, 1.7976931348623157e308 },
+    { "1.7976931348623158e308", true, 1.7976931348623157e308 },
+    { "1.7976931348623159e308", false, 0.0 },
+    { "1e400", false, 0.0 },
+    { "inf", true, HUGE_VAL },
+    { "-Infinity", true, -HUGE_VAL },
+    { "", false, 0.0 },
+    { ".", false, 0.0 },
+    { "1e", false, 0.0 },
+    { "1.2.3", false, 0.0 },
+    { "0x10", false, 0.0 },
+    { "1,5", false, 0.0 },
+};
+
+static uint64_t test_random(uint64_t* state)
+{
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * UINT64_C(2685821657736338717);
+}
+
+static int32_t test_int64_parser(const char* name, bool (*parse)(const char*, int64_t*), const test_int64* cases, const int32_t case_count)
+{
+    int32_t failures = 0;
+    for (int32_t i = 0; i < case_count; ++i)
+    {
+        int64_t value = 0;
+        const bool valid = parse(cases[i].str, &value);
+        if (valid != cases[i].valid || (valid && value != cases[i].value))
+        {
+            printf("%s mismatch: '%s' gave %lld\n", name, cases[i].str, (long long)value);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+static int32_t test_size_parser(void)
+{
+    int32_t failures = 0;
+    for (int32_t i = 0; i < (int32_t)CCMD_ARRAY_SIZE(size_cases); ++i)
+    {
+        uint64_t value = 0;
+        const bool valid = ccmd_parse_size(size_cases[i].str, &value);
+        if (valid != size_cases[i].valid || (valid && value != size_cases[i].value))
+        {
+            printf("size mismatch: '%s' gave %llu\n", size_cases[i].str, (unsigned long long)value);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+static bool test_same_double(const double lhs, const double rhs)
+{
+    return memcmp(&lhs, &rhs, sizeof(double)) == 0;
+}
+
+static int32_t test_double_parser(void)
+{
+    int32_t failures = 0;
+    for (int32_t i = 0; i < (int32_t)CCMD_ARRAY_SIZE(double_cases); ++i)
+    {
+        double value = 0.0;
+        const bool valid = ccmd_parse_double(double_cases[i].str, &value);
+        if (valid != double_cases[i].valid || (valid && !test_same_double(value, double_cases[i].value)))
+        {
+            printf("double mismatch: '%s' gave %.17g\n", double_cases[i].str, value);
+            ++failures;
+        }
+    }
+
+    // strtod rounds correctly in the C locale the test runs in, so random digit strings across the whole range
+    // (including long ones that never take the fast path) have to convert to exactly the same double
+    uint64_t state = UINT64_C(0x9E3779B97F4A7C15);
+    for (int32_t i = 0; i < TEST_RANDOM_DOUBLES; ++i)
+    {
+        char str[128];
+        int32_t length = 0;
+        const int32_t digits = 1 + (int32_t)(test_random(&state) % 40);
+        const int32_t point = (int32_t)(test_random(&state) % (digits + 1));
+        for (int32_t digit = 0; digit < digits; ++digit)
+        {
+            if (digit == point)
+            {
+                str[length++] = '.';
+            }
+            str[length++] = (char)('0' + test_random(&state) % 10);
+        }
+        snprintf(str + length, sizeof(str) - length, "e%d", (int)(test_random(&state) % 700) - 350);
+
+        double value = 0.0;
+        const double expected = strtod(str, NULL);
+        const bool valid = ccmd_parse_double(str, &value);
+        if (valid != (expected != HUGE_VAL) || (valid && !test_same_double(value, expected)))
+        {
+            printf("double mismatch: '%s' gave %.17g instead of %.17g\n", str, value, expected);
+            ++failures;
+        }
+    }
+
+    return failures;
+}
+
+typedef struct test_config
+{
+    double      ratio;
+    int64_t     timeout;
+    ccmd_append_list sizes;
+} test_config;
+
+// typed options need nothing but the usual result storage - the values are checked and the actions still get them
+static int32_t test_values_without_storage(void)
+{
+    const ccmd_option options[] = {
+        { .long_name = "ratio", .help = "a ratio", .nargs = 1, .value_type = CCMD_VALUE_DOUBLE, .action = CCMD_ACTION_STORE_VALUE, .offset = offsetof(test_config, ratio) },
+        { .long_name = "timeout", .help = "a timeout", .nargs = 1, .value_type = CCMD_VALUE_DURATION, .action = CCMD_ACTION_STORE_VALUE, .offset = offsetof(test_config, timeout) },
+        { .long_name = "size", .help = "sizes", .nargs = 2, .value_type = CCMD_VALUE_SIZE, .action = CCMD_ACTION_APPEND, .offset = offsetof(test_config, sizes) },
+    };
+    const ccmd_command cli = {
+        .name = "prog",
+        .options = CCMD_ARRAY_VIEW(options),
+    };
+
+    ccmd_value size_values[4];
+    test_config config = { 0 };
+    config.sizes.capacity = (int32_t)CCMD_ARRAY_SIZE(size_values);
+    config.sizes.values = size_values;
+
+    ccmd_context context = { 0 };
+    ccmd_command_result commands[4];
+    ccmd_parsed_args parsed[4];
+    ccmd_error errors[4];
+    ccmd_result result = {
+        .context = &context,
+        .commands = CCMD_ARRAY_VIEW(commands),
+        .options = CCMD_ARRAY_VIEW(parsed),
+        .errors = CCMD_ARRAY_VIEW(errors),
+        .destination = &config,
+    };
+
+    int32_t failures = 0;
+
+    char* args[] = { "prog", "--ratio", "0.1", "--timeout", "1h30m", "--size", "4KiB", "0.001KB" };
+    if (ccmd_parse(&result, CCMD_ARRAY_SIZE(args), args, &cli) != CCMD_STATUS_SUCCESS
+        || ccmd_get_option(result.program_command, "ratio")->values != NULL
+        || config.ratio != 0.1
+        || config.timeout != INT64_C(5400000000000)
+        || config.sizes.count != 2
+        || size_values[0].size != 4096
+        || size_values[1].size != 1)
+    {
+        printf("typed options without value storage weren't converted for their actions\n");
+        ++failures;
+    }
+
+    char* invalid_args[] = { "prog", "--timeout", "90" };
+    if (ccmd_parse(&result, CCMD_ARRAY_SIZE(invalid_args), invalid_args, &cli) != CCMD_STATUS_ERROR
+        || result.error_count != 1
+        || CCMD_ERROR_KEY_CATEGORY(result.errors.data[0].key) != CCMD_ERROR_CATEGORY_INVALID_VALUE)
+    {
+        printf("an invalid typed option without value storage wasn't reported\n");
+        ++failures;
+    }
+
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    int32_t failures = 0;
+    failures += test_int64_parser("int64", ccmd_parse_int64, int64_cases, CCMD_ARRAY_SIZE(int64_cases));
+    failures += test_size_parser();
+    failures += test_int64_parser("duration", ccmd_parse_duration, duration_cases, CCMD_ARRAY_SIZE(duration_cases));
+    failures += test_double_parser();
+    failures += test_values_without_storage();
+
+    printf("values: %d failures\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}